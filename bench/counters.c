@@ -0,0 +1,355 @@
+/*
+ * Reports hardware performance counters per input byte for the
+ * library's public functions, over fixed inputs.
+ *
+ * Usage: bench/counters [name ...]
+ *
+ * With no arguments every benchmark is run; otherwise only those
+ * whose names begin with an argument. Counters that the kernel or
+ * CPU cannot provide (for example, in a virtual machine or when
+ * /proc/sys/kernel/perf_event_paranoid forbids them) are shown as "-",
+ * and the time per byte is always shown.
+ *
+ * This is Linux-specific, and is only built on request with
+ * "make bench/counters".
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "redjson.h"
+
+#define MIN_NS		200000000	/* run each benchmark for 0.2 s */
+
+/* The counters, in the order of the report's columns */
+static const struct counter {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+} counters[] = {
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "instrs", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ "L1d-miss", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+	    PERF_COUNT_HW_CACHE_OP_READ << 8 |
+	    PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+	{ "LLC-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+};
+#define NCOUNTERS (sizeof counters / sizeof counters[0])
+
+/*
+ * The counters are opened as one group, so that they are scheduled
+ * onto the PMU together and their ratios come from the same cycles,
+ * even when the group is multiplexed with other events.
+ */
+static int leader = -1;		/* the group leader's file descriptor */
+static int slot[NCOUNTERS];	/* each counter's place in the group, or -1 */
+static size_t ngroup;		/* the number of counters in the group */
+
+/** Opens a counter for this thread's user-space execution */
+static int
+open_counter(const struct counter *c, int group_fd)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof attr);
+	attr.size = sizeof attr;
+	attr.type = c->type;
+	attr.config = c->config;
+	attr.disabled = group_fd == -1;	/* members follow the leader */
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	/* The group may be multiplexed; the times allow scaling */
+	attr.read_format = PERF_FORMAT_GROUP |
+	    PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+/** Opens the counters that are available as a group */
+static void
+open_counters(void)
+{
+	size_t i;
+	int fd;
+
+	for (i = 0; i < NCOUNTERS; i++) {
+		slot[i] = -1;
+		fd = open_counter(&counters[i], leader);
+		if (fd < 0) {
+			fprintf(stderr, "%s: %s\n", counters[i].name,
+			    strerror(errno));
+			continue;
+		}
+		if (leader < 0)
+			leader = fd;
+		slot[i] = ngroup++;
+	}
+}
+
+/**
+ * Reads every counter, scaled for the time the group was not running.
+ * Counters that are unavailable read as -1.
+ */
+static void
+read_counters(double v[NCOUNTERS])
+{
+	/* nr, time enabled, time running, then a value per member */
+	uint64_t r[3 + NCOUNTERS];
+	size_t i;
+	ssize_t n = -1;
+
+	if (leader >= 0)
+		n = read(leader, r, sizeof r);
+	for (i = 0; i < NCOUNTERS; i++) {
+		if (slot[i] < 0 || n < (ssize_t)((3 + ngroup) * sizeof r[0]) ||
+		    !r[2])
+			v[i] = -1;
+		else
+			v[i] = (double)r[3 + slot[i]] * r[1] / r[2];
+	}
+}
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Inputs and their lengths, built once by make_inputs() */
+static char *doc;		/* an array of records */
+static char *long_str;		/* a long string with some escapes */
+static char *base64;		/* a long BASE-64 string */
+static char *numbers;		/* an array of numbers */
+static char *utf8;		/* plain text to be quoted */
+static char *padded_doc;	/* doc, padded */
+static size_t doc_len, long_str_len, base64_len, numbers_len, utf8_len;
+static char buf[1 << 20];	/* output */
+static volatile size_t sink;	/* defeats dead code elimination */
+
+/** Allocates a string and appends n formatted copies of a record */
+static char *
+repeat(const char *head, const char *fmt, int n, const char *tail)
+{
+	size_t sz = strlen(head) + strlen(tail) + 1;
+	size_t len;
+	char *s;
+	int i;
+
+	sz += (size_t)n * (strlen(fmt) + 64);
+	s = malloc(sz);
+	if (!s) {
+		perror("malloc");
+		exit(1);
+	}
+	len = snprintf(s, sz, "%s", head);
+	for (i = 0; i < n; i++)
+		len += snprintf(s + len, sz - len, fmt, i, i * 0.25, i);
+	if (len && s[len - 1] == ',')
+		len--;
+	snprintf(s + len, sz - len, "%s", tail);
+	return s;
+}
+
+static void
+make_inputs(void)
+{
+	doc = repeat("[", "{\"id\":%d,\"score\":%g,\"name\":\"user %d\","
+	    "\"tags\":[\"a\",\"b\"],\"ok\":true},", 2000, "]");
+	long_str = repeat("\"", "line %d, %g\\tcolumn %d\\n", 2000, "\"");
+	base64 = repeat("\"", "QUJD%04dRUZH%04.0fSUpL%04d", 2000, "\"");
+	numbers = repeat("[", "%d,%g,-%d.5e3,", 2000, "]");
+	utf8 = repeat("", "caf\xc3\xa9 %d \"%g\" <%d>/", 2000, "");
+	doc_len = strlen(doc);
+	long_str_len = strlen(long_str);
+	base64_len = strlen(base64);
+	numbers_len = strlen(numbers);
+	utf8_len = strlen(utf8);
+	padded_doc = json_padded_strndup(doc, doc_len);
+}
+
+/* The benchmarks. Each returns the number of input bytes processed. */
+
+static size_t
+bench_span(void)
+{
+	sink += json_span(doc);
+	return doc_len;
+}
+
+static size_t
+bench_span_padded(void)
+{
+	sink += json_span_padded(padded_doc);
+	return doc_len;
+}
+
+static size_t
+bench_select(void)
+{
+	sink += (size_t)json_select(doc, "[1999].tags[1]");
+	return doc_len;
+}
+
+static size_t
+bench_array_length(void)
+{
+	sink += json_array_length(doc);
+	return doc_len;
+}
+
+static size_t
+bench_object_next(void)
+{
+	const char *ai = json_as_array(doc);
+	const char *elem;
+
+	while ((elem = json_array_next(&ai))) {
+		const char *oi = json_as_object(elem);
+		const char *key;
+		while (json_object_next(&oi, &key))
+			sink++;
+	}
+	return doc_len;
+}
+
+static size_t
+bench_as_str(void)
+{
+	sink += json_as_str(long_str, buf, sizeof buf);
+	return long_str_len;
+}
+
+static size_t
+bench_as_bytes(void)
+{
+	sink += json_as_bytes(base64, buf, sizeof buf);
+	return base64_len;
+}
+
+static size_t
+bench_as_double(void)
+{
+	const char *ai = json_as_array(numbers);
+	const char *elem;
+	double sum = 0;
+
+	while ((elem = json_array_next(&ai)))
+		sum += json_as_double(elem);
+	sink += sum != 0;
+	return numbers_len;
+}
+
+static size_t
+bench_as_float_array(void)
+{
+	sink += json_as_float_array(numbers, (float *)buf,
+	    sizeof buf / sizeof (float));
+	return numbers_len;
+}
+
+static size_t
+bench_from_str(void)
+{
+	sink += json_from_str(utf8, buf, sizeof buf);
+	return utf8_len;
+}
+
+static size_t
+bench_transcode(void)
+{
+	sink += json_transcode(JSON_ENCODING_LATIN1, utf8, utf8_len,
+	    buf, sizeof buf);
+	return utf8_len;
+}
+
+static const struct bench {
+	const char *name;
+	size_t (*fn)(void);
+} benches[] = {
+	{ "json_span", bench_span },
+	{ "json_span_padded", bench_span_padded },
+	{ "json_select", bench_select },
+	{ "json_array_length", bench_array_length },
+	{ "json_object_next", bench_object_next },
+	{ "json_as_str", bench_as_str },
+	{ "json_as_bytes", bench_as_bytes },
+	{ "json_as_double", bench_as_double },
+	{ "json_as_float_array", bench_as_float_array },
+	{ "json_from_str", bench_from_str },
+	{ "json_transcode", bench_transcode },
+};
+
+/** Runs a benchmark for a while, and prints its counts per byte */
+static void
+run(const struct bench *b)
+{
+	double start[NCOUNTERS], end[NCOUNTERS];
+	uint64_t t0, ns;
+	size_t bytes = 0;
+	size_t i;
+
+	(void) b->fn();		/* warm the caches */
+	read_counters(start);
+	t0 = now_ns();
+	do {
+		bytes += b->fn();
+	} while ((ns = now_ns() - t0) < MIN_NS);
+	read_counters(end);
+
+	printf("%-20s %8.3f", b->name, (double)ns / bytes);
+	for (i = 0; i < NCOUNTERS; i++) {
+		if (end[i] < 0 || start[i] < 0)
+			printf(" %9s", "-");
+		else
+			printf(" %9.4f", (end[i] - start[i]) / bytes);
+	}
+	printf("\n");
+}
+
+/** Tests if a benchmark was selected on the command line */
+static int
+selected(const char *name, int argc, char *argv[])
+{
+	int i;
+
+	if (argc < 2)
+		return 1;
+	for (i = 1; i < argc; i++)
+		if (strncmp(name, argv[i], strlen(argv[i])) == 0)
+			return 1;
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	size_t i;
+
+	make_inputs();
+	open_counters();
+	if (leader < 0)
+		fprintf(stderr, "no hardware counters; reporting time only\n");
+	else
+		ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+	printf("CPU features 0x%x\n", json_cpu_features());
+	printf("%-20s %8s", "per byte", "ns");
+	for (i = 0; i < NCOUNTERS; i++)
+		printf(" %9s", counters[i].name);
+	printf("\n");
+	for (i = 0; i < sizeof benches / sizeof benches[0]; i++)
+		if (selected(benches[i].name, argc, argv))
+			run(&benches[i]);
+	return 0;
+}
@@ -0,0 +1,263 @@
+/*
+ * Records the selections that a program makes, for bench/replay.
+ *
+ * Usage: REDJSON_TRACE=trace.txt LD_PRELOAD=bench/.libs/librecord.so prog
+ *
+ * This shim interposes json_select() and json_selectv(), which the
+ * other selection functions (such as json_default_select_int()) call.
+ * For each call it writes the document (the first time it is seen),
+ * the path as written and as expanded with its arguments, and where
+ * the result was found. Without REDJSON_TRACE it only passes calls on.
+ *
+ * The trace is text, one record per line:
+ *
+ *     doc <id> <length>          followed by the document's bytes and \n
+ *     select <id> <result> <fn> <path>\t<expanded path>
+ *
+ * where <id> is a hash of the document's text, and <result> is the
+ * offset of the selected value, -1 if it was not found, or -2 if the
+ * call failed with EINVAL. Such calls may have malformed paths, which
+ * cannot be expanded faithfully, so they are not replayed. The path
+ * may be empty. The expanded path escapes '\\', '.', '[', '%', tab and
+ * newline in keys with a backslash.
+ *
+ * Programs linked statically with the library cannot be recorded.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "redjson.h"
+
+typedef const char *(*selectv_fn)(const char *, const char *, va_list);
+typedef size_t (*span_fn)(const char *);
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *trace;		/* NULL if not recording */
+static int initialized;
+static selectv_fn real_selectv;
+static span_fn real_span;
+
+/* Nonzero while this thread is inside a recorded call */
+static __thread int recording;
+
+/* The ids of the documents already written, open addressed */
+static uint64_t *seen;
+static size_t nseen, seen_alloc;	/* seen_alloc is a power of 2 */
+
+static void
+finish(void)
+{
+	pthread_mutex_lock(&lock);
+	if (trace)
+		fclose(trace);
+	trace = NULL;
+	pthread_mutex_unlock(&lock);
+}
+
+/** Finds the library's functions, and opens the trace. Called locked. */
+static void
+init(void)
+{
+	const char *path = getenv("REDJSON_TRACE");
+
+	initialized = 1;
+	real_selectv = (selectv_fn)dlsym(RTLD_NEXT, "json_selectv");
+	real_span = (span_fn)dlsym(RTLD_NEXT, "json_span");
+	if (!real_selectv || !real_span) {
+		fprintf(stderr, "record: %s\n", dlerror());
+		abort();
+	}
+	if (path && *path) {
+		trace = fopen(path, "w");
+		if (!trace)
+			perror(path);
+		else
+			atexit(finish);
+	}
+}
+
+/** Hashes text with FNV-1a */
+static uint64_t
+doc_id(const char *p, size_t len)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	while (len--)
+		h = (h ^ (unsigned char)*p++) * 0x100000001b3ULL;
+	return h ? h : 1;	/* 0 marks an empty slot */
+}
+
+/** Adds an id to the seen set. Returns 0 if it was already there. */
+static int
+add_seen(uint64_t id)
+{
+	size_t i;
+
+	if ((nseen + 1) * 2 > seen_alloc) {
+		size_t n = seen_alloc ? seen_alloc * 2 : 256;
+		uint64_t *s = calloc(n, sizeof *s);
+		if (!s)
+			return 0;
+		for (i = 0; i < seen_alloc; i++) {
+			size_t j;
+			if (!seen[i])
+				continue;
+			for (j = seen[i] & (n - 1); s[j]; j = (j + 1) & (n - 1))
+				;
+			s[j] = seen[i];
+		}
+		free(seen);
+		seen = s;
+		seen_alloc = n;
+	}
+	for (i = id & (seen_alloc - 1); seen[i]; i = (i + 1) & (seen_alloc - 1))
+		if (seen[i] == id)
+			return 0;
+	seen[i] = id;
+	nseen++;
+	return 1;
+}
+
+/** Writes a key of the expanded path, escaping the path syntax */
+static void
+put_key(const char *key, size_t len)
+{
+	putc('.', trace);
+	for (; len--; key++) {
+		if (*key == '\t')
+			fputs("\\t", trace);
+		else if (*key == '\n')
+			fputs("\\n", trace);
+		else {
+			if (strchr("\\.[%", *key))
+				putc('\\', trace);
+			putc(*key, trace);
+		}
+	}
+}
+
+/**
+ * Writes a path, substituting its arguments.
+ * This follows the syntax accepted by next_path_component().
+ */
+static void
+put_expanded(const char *path, va_list ap)
+{
+	int first = 1;
+
+	while (*path) {
+		if (*path == '[') {
+			path++;
+			if (path[0] == '%' && path[1] == 'd') {
+				fprintf(trace, "[%d", va_arg(ap, int));
+				path += 2;
+			} else if (path[0] == '%' && path[1] == 'u') {
+				fprintf(trace, "[%u", va_arg(ap, unsigned));
+				path += 2;
+			} else {
+				putc('[', trace);
+				while (*path && *path != ']')
+					putc(*path++, trace);
+			}
+			if (*path == ']')
+				path++;
+			putc(']', trace);
+		} else {
+			size_t n;
+			if (*path == '.')
+				path++;
+			else if (!first)
+				return;	/* malformed; the trace shows it */
+			if (path[0] == '%' && path[1] == 's') {
+				const char *key = va_arg(ap, const char *);
+				if (key)
+					put_key(key, strlen(key));
+				path += 2;
+			} else {
+				n = strcspn(path, ".[");
+				put_key(path, n);
+				path += n;
+			}
+		}
+		first = 0;
+	}
+}
+
+/** Writes the trace record for a completed selection. Called locked. */
+static void
+put_select(const char *fn, const char *json, const char *path,
+	va_list ap, const char *result, int error)
+{
+	size_t len = real_span(json);
+	uint64_t id = doc_id(json, len);
+	long long offset;
+
+	if (add_seen(id)) {
+		fprintf(trace, "doc %016llx %zu\n", (unsigned long long)id, len);
+		fwrite(json, 1, len, trace);
+		putc('\n', trace);
+	}
+	if (result)
+		offset = result - json;
+	else
+		offset = error == EINVAL ? -2 : -1;
+	fprintf(trace, "select %016llx %lld %s %s\t",
+	    (unsigned long long)id, offset, fn, path);
+	put_expanded(path, ap);
+	putc('\n', trace);
+}
+
+static const char *
+record(const char *fn, const char *json, const char *path, va_list ap)
+{
+	const char *result;
+	int save_errno;
+	va_list ap2;
+
+	pthread_mutex_lock(&lock);
+	if (!initialized)
+		init();
+	pthread_mutex_unlock(&lock);
+
+	va_copy(ap2, ap);
+	recording++;
+	result = real_selectv(json, path, ap);
+	recording--;
+	save_errno = errno;
+	if (trace && json && path && !recording) {
+		pthread_mutex_lock(&lock);
+		if (trace)
+			put_select(fn, json, path, ap2, result,
+			    save_errno);
+		pthread_mutex_unlock(&lock);
+	}
+	va_end(ap2);
+	errno = save_errno;
+	return result;
+}
+
+const char *
+json_selectv(const char *json, const char *path, va_list ap)
+{
+	return record("json_selectv", json, path, ap);
+}
+
+const char *
+json_select(const char *json, const char *path, ...)
+{
+	const char *result;
+	va_list ap;
+
+	va_start(ap, path);
+	result = record("json_select", json, path, ap);
+	va_end(ap);
+	return result;
+}
@@ -0,0 +1,353 @@
+/*
+ * Replays a trace written by bench/record, and reports the time
+ * taken by each kind of selection.
+ *
+ * Usage: bench/replay trace.txt [seconds]
+ *
+ * The trace is replayed repeatedly for at least the given time
+ * (default 1 s). Calls are grouped by function and path as written
+ * in the program, and the groups are reported in order of total time.
+ * Results that differ from those recorded are counted as mismatches,
+ * which makes the replay a check on behaviour as well as speed.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "redjson.h"
+
+/* A component of an expanded path, for replays that need arguments */
+struct component {
+	char *key;		/* NULL for an index */
+	int index;
+};
+
+/* A group of calls made with the same function and path */
+struct group {
+	char *fn;
+	char *path;
+	unsigned long calls;
+	uint64_t ns;
+};
+
+/* A recorded call */
+struct call {
+	const char *doc;
+	long long result;	/* offset of the expected result, or -1 */
+	size_t group;		/* index into groups[] */
+	char *literal;		/* the path, if it can be replayed as one */
+	struct component *comps;	/* otherwise, its components */
+	size_t ncomps;
+};
+
+/* A recorded document */
+struct doc {
+	char id[17];
+	char *text;
+};
+
+static struct doc *docs;
+static size_t ndocs, docs_alloc;
+static struct call *calls;
+static size_t ncalls, calls_alloc;
+static struct group *groups;
+static size_t ngroups, groups_alloc;
+static size_t nskipped;		/* calls that failed with EINVAL */
+
+static void *
+xrealloc(void *p, size_t sz)
+{
+	p = realloc(p, sz);
+	if (!p) {
+		perror("realloc");
+		exit(1);
+	}
+	return p;
+}
+
+static char *
+xstrndup(const char *s, size_t len)
+{
+	char *d = xrealloc(NULL, len + 1);
+
+	memcpy(d, s, len);
+	d[len] = '\0';
+	return d;
+}
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const char *
+find_doc(const char *id)
+{
+	size_t i;
+
+	for (i = 0; i < ndocs; i++)
+		if (strcmp(docs[i].id, id) == 0)
+			return docs[i].text;
+	return NULL;
+}
+
+static size_t
+find_group(const char *fn, const char *path)
+{
+	size_t i;
+
+	for (i = 0; i < ngroups; i++)
+		if (strcmp(groups[i].fn, fn) == 0 &&
+		    strcmp(groups[i].path, path) == 0)
+			return i;
+	if (ngroups == groups_alloc) {
+		groups_alloc = groups_alloc ? groups_alloc * 2 : 16;
+		groups = xrealloc(groups, groups_alloc * sizeof *groups);
+	}
+	memset(&groups[ngroups], 0, sizeof groups[ngroups]);
+	groups[ngroups].fn = xstrndup(fn, strlen(fn));
+	groups[ngroups].path = xstrndup(path, strlen(path));
+	return ngroups++;
+}
+
+/**
+ * Parses an expanded path into a call's replay plan.
+ * Paths whose keys need escaping, or with negative indices,
+ * are replayed a component at a time.
+ */
+static void
+plan(struct call *c, const char *exp)
+{
+	size_t alloc = 0;
+	int literal = 1;
+	const char *p;
+
+	c->ncomps = 0;
+	c->comps = NULL;
+	for (p = exp; *p; ) {
+		struct component *comp;
+
+		if (c->ncomps == alloc) {
+			alloc = alloc ? alloc * 2 : 8;
+			c->comps = xrealloc(c->comps, alloc * sizeof *c->comps);
+		}
+		comp = &c->comps[c->ncomps++];
+		if (*p == '[') {
+			comp->key = NULL;
+			comp->index = atoi(p + 1);
+			if (comp->index < 0)
+				literal = 0;
+			p = strchr(p, ']');
+			p = p ? p + 1 : exp + strlen(exp);
+		} else {
+			char *k;
+			p++;	/* '.' */
+			k = comp->key = xrealloc(NULL, strlen(p) + 1);
+			while (*p && *p != '.' && *p != '[') {
+				if (*p == '\\' && p[1]) {
+					literal = 0;
+					p++;
+					*k++ = *p == 't' ? '\t' :
+					       *p == 'n' ? '\n' : *p;
+					p++;
+				} else
+					*k++ = *p++;
+			}
+			*k = '\0';
+			if (!*comp->key)
+				literal = 0;
+		}
+	}
+	c->literal = literal ? xstrndup(exp, strlen(exp)) : NULL;
+}
+
+/** Splits off the next field of a record, which ends at a space */
+static char *
+next_field(char **p)
+{
+	char *field = *p;
+	char *end = strchr(field, ' ');
+
+	if (!end)
+		return NULL;
+	*end = '\0';
+	*p = end + 1;
+	return field;
+}
+
+/** Loads a trace file into the docs, calls and groups */
+static void
+load(const char *filename)
+{
+	FILE *f = fopen(filename, "r");
+	char *line = NULL;
+	size_t linesz = 0;
+	ssize_t len;
+
+	if (!f) {
+		perror(filename);
+		exit(1);
+	}
+	while ((len = getline(&line, &linesz, f)) > 0) {
+		char id[17];
+		size_t doclen;
+
+		if (line[len - 1] == '\n')
+			line[--len] = '\0';
+		if (sscanf(line, "doc %16s %zu", id, &doclen) == 2) {
+			struct doc *d;
+			if (ndocs == docs_alloc) {
+				docs_alloc = docs_alloc ? docs_alloc * 2 : 64;
+				docs = xrealloc(docs, docs_alloc * sizeof *docs);
+			}
+			d = &docs[ndocs++];
+			strcpy(d->id, id);
+			d->text = xrealloc(NULL, doclen + 1);
+			if (fread(d->text, 1, doclen, f) != doclen ||
+			    getc(f) != '\n')
+				goto bad;
+			d->text[doclen] = '\0';
+		} else if (strncmp(line, "select ", 7) == 0) {
+			/* The path may be empty or hold spaces. Tabs in the
+			 * expanded path are escaped, so the last one ends it */
+			char *p = line + 7, *end;
+			char *doc_id = next_field(&p);
+			char *result = next_field(&p);
+			char *fn = next_field(&p);
+			char *tab = strrchr(p, '\t');
+			long long offset;
+			struct call *c;
+
+			if (!doc_id || !result || !fn || !tab)
+				goto bad;
+			*tab = '\0';
+			offset = strtoll(result, &end, 10);
+			if (end == result || *end || offset < -2)
+				goto bad;
+			if (offset == -2) {
+				/* A malformed path, which may not have been
+				 * expanded as the library parsed it */
+				nskipped++;
+				continue;
+			}
+			if (ncalls == calls_alloc) {
+				calls_alloc = calls_alloc ? calls_alloc * 2 : 1024;
+				calls = xrealloc(calls,
+				    calls_alloc * sizeof *calls);
+			}
+			c = &calls[ncalls++];
+			c->doc = find_doc(doc_id);
+			if (!c->doc)
+				goto bad;
+			c->result = offset;
+			c->group = find_group(fn, p);
+			plan(c, tab + 1);
+		} else
+			goto bad;
+	}
+	free(line);
+	fclose(f);
+	return;
+bad:
+	fprintf(stderr, "%s: bad record: %s\n", filename, line);
+	exit(1);
+}
+
+/* Literal paths have no '%', so they are safe as formats. Calling
+ * through a pointer avoids the warning for non-literal formats. */
+static const char *(*select_literal)(const char *, const char *, ...) =
+	json_select;
+
+/** Replays one call, and returns its result */
+static const char *
+replay(const struct call *c)
+{
+	const char *json = c->doc;
+	size_t i;
+
+	if (c->literal)
+		return select_literal(json, c->literal);
+	for (i = 0; json && i < c->ncomps; i++) {
+		if (c->comps[i].key)
+			json = json_select(json, ".%s", c->comps[i].key);
+		else
+			json = json_select(json, "[%d]", c->comps[i].index);
+	}
+	return json;
+}
+
+static int
+by_total(const void *a, const void *b)
+{
+	const struct group *ga = a, *gb = b;
+
+	return ga->ns < gb->ns ? 1 : ga->ns > gb->ns ? -1 : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	double seconds = argc > 2 ? atof(argv[2]) : 1;
+	unsigned long mismatches = 0, rounds = 0;
+	uint64_t overhead = UINT64_MAX, start;
+	size_t i;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s trace [seconds]\n", argv[0]);
+		return 2;
+	}
+	load(argv[1]);
+	if (!ncalls) {
+		fprintf(stderr, "%s: no calls\n", argv[1]);
+		return 1;
+	}
+
+	/* The least time of an empty measurement */
+	for (i = 0; i < 1000; i++) {
+		uint64_t t0 = now_ns(), t = now_ns() - t0;
+		if (t < overhead)
+			overhead = t;
+	}
+
+	start = now_ns();
+	do {
+		for (i = 0; i < ncalls; i++) {
+			const struct call *c = &calls[i];
+			const char *result;
+			uint64_t t0 = now_ns(), t;
+			result = replay(c);
+			t = now_ns() - t0;
+			groups[c->group].ns += t > overhead ? t - overhead : 0;
+			groups[c->group].calls++;
+			if ((result ? result - c->doc : -1) != c->result)
+				mismatches++;
+		}
+		rounds++;
+	} while (now_ns() - start < seconds * 1e9);
+
+	qsort(groups, ngroups, sizeof *groups, by_total);
+	printf("%zu calls, %zu documents, %lu rounds, json_cpu_features 0x%x\n",
+	    ncalls, ndocs, rounds, json_cpu_features());
+	if (nskipped)
+		printf("%zu calls that failed with EINVAL were not replayed\n",
+		    nskipped);
+	printf("%10s %10s %10s  %s\n", "calls", "ns/call", "total ms",
+	    "function and path");
+	for (i = 0; i < ngroups; i++)
+		printf("%10lu %10.1f %10.3f  %s %s\n", groups[i].calls,
+		    (double)groups[i].ns / groups[i].calls,
+		    groups[i].ns / 1e6, groups[i].fn, groups[i].path);
+	if (mismatches) {
+		printf("%lu results differ from the trace\n", mismatches);
+		return 1;
+	}
+	return 0;
+}
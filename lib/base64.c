@@ -1,4 +1,7 @@
 #include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "private.h"
 #include "utf8.h"
@@ -7,7 +10,34 @@
 #define PAD 0xfeu  /* padding '=' */
 #define SPC 0xfdu  /* whitespace */
 
+const
+char hex_to_char[16] = "0123456789abcdef";
+
+/*
+ * Map characters from { U+0 .. U+FF } into their hexadecimal digit value,
+ * or to BAD
+ */
 static const
+unsigned char char_to_hex[256] = {
+  /* 00 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* 10 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* 20 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* 30 */   0,  1,  2,  3,  4,  5,  6,  7,   8,  9,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* 40 */ BAD, 10, 11, 12, 13, 14, 15,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* 50 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* 60 */ BAD, 10, 11, 12, 13, 14, 15,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* 70 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* 80 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* 90 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* a0 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* b0 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* c0 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* d0 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* e0 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+  /* f0 */ BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD, BAD,BAD,BAD,BAD,BAD,BAD,BAD,BAD,
+};
+
+const
 char base64_to_char[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
 			  "abcdefghijklmnopqrstuvwxyz"
 			  "0123456789+/";
@@ -170,25 +200,10 @@ json_from_bytes(const void *src, size_t srcsz,
 #	define OUT(c) *out++ = (c)
 
 	OUT('"');
-	while (srcsz >= 3) {
-		/* 00000000 11111111 22222222 */
-		/* aaaaaabb bbbbcccc ccdddddd */
-		unsigned char a;
-		unsigned char b;
-		unsigned char c;
-		unsigned char d;
-
-		a = (s[0] >> 2);
-		OUT(base64_to_char[a]);
-		b = (s[0] << 4) | (s[1] >> 4);
-		OUT(base64_to_char[b & 63]);
-		c = (s[1] << 2) | (s[2] >> 6);
-		OUT(base64_to_char[c & 63]);
-		d = s[2];
-		OUT(base64_to_char[d & 63]);
-		s += 3;
-		srcsz -= 3;
-	}
+	base64_encode(s, srcsz, out);
+	out += srcsz / 3 * 4;
+	s += srcsz / 3 * 3;
+	srcsz %= 3;
 	if (srcsz) {
 		unsigned char a;
 		unsigned char b;
@@ -218,3 +233,77 @@ json_from_bytes(const void *src, size_t srcsz,
 	return out - dst;
 #	undef OUT
 }
+
+__PUBLIC
+int
+json_as_hex(const __JSON char *json, void *buf, size_t bufsz)
+{
+	unsigned char *d = buf, *dend = d + bufsz;
+	const __JSON char *start;
+	size_t len;
+	char quote;
+
+	skip_white(&json);
+	if (!json)
+		goto invalid;
+
+	quote = *json++;
+	if (quote != '"' && quote != '\'')
+		goto invalid;
+
+	/* Convert whole pairs while both are digits, so that the
+	 * common case is one table lookup per digit with a single,
+	 * well-predicted test per output byte */
+	start = json;
+	for (;;) {
+		unsigned hi = char_to_hex[(unsigned char)json[0]];
+		unsigned lo;
+
+		if (hi == BAD)
+			break;
+		lo = char_to_hex[(unsigned char)json[1]];
+		if (lo == BAD)
+			goto invalid; /* odd digit count */
+		if (bufsz) {
+			if (d == dend)
+				goto nomem;
+			*d++ = (hi << 4) | lo;
+		}
+		json += 2;
+	}
+	if (*json != quote)
+		goto invalid;
+	len = (json - start) / 2;
+	if (len > INT_MAX) {
+		errno = EOVERFLOW;
+		return -1;
+	}
+	return (int)len;
+
+invalid:
+	errno = EINVAL;
+	return -1;
+nomem:
+	errno = ENOMEM;
+	return -1;
+}
+
+__PUBLIC
+int
+json_from_hex(const void *src, size_t srcsz, __JSON char *dst, size_t dstsz)
+{
+	const unsigned char *s = src;
+	__JSON char *out = dst;
+
+	if (dstsz < JSON_FROM_HEX_DSTSZ(srcsz)) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	*out++ = '"';
+	hex_encode(s, srcsz, out);
+	out += srcsz * 2;
+	*out++ = '"';
+	*out = '\0';
+	return out - dst;
+}
@@ -0,0 +1,209 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "private.h"
+
+#ifdef __linux__
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <linux/mempolicy.h>
+# define HAVE_MMAP
+#endif
+
+#define HUGE_PAGE_SZ	((size_t)2 << 20)	/* the usual huge page size */
+#define BIG_MIN		HUGE_PAGE_SZ	/* smaller blocks use the heap */
+#define ALIGN		64		/* a cache line */
+
+/* The policy set by json_set_alloc_policy() */
+static unsigned alloc_policy;
+
+/*
+ * Every block begins with a header that records how it was allocated.
+ * The header is padded so that the caller's memory stays aligned to
+ * a cache line.
+ */
+union header {
+	struct {
+		size_t maplen;	/* length of the mapping, or 0 if from the heap */
+		size_t len;	/* the length the caller asked for */
+	};
+	char pad[ALIGN];
+};
+
+#ifdef HAVE_MMAP
+/** Maps anonymous memory aligned to a huge page, or returns NULL */
+static void *
+map_aligned(size_t maplen)
+{
+	char *p, *aligned;
+	size_t head;
+
+	p = mmap(NULL, maplen + HUGE_PAGE_SZ, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+	/* Trim the mapping to an aligned start, so that THP can use it */
+	aligned = (char *)(((uintptr_t)p + HUGE_PAGE_SZ - 1) &
+	    ~(uintptr_t)(HUGE_PAGE_SZ - 1));
+	head = aligned - p;
+	if (head)
+		munmap(p, head);
+	munmap(aligned + maplen, HUGE_PAGE_SZ - head);
+	return aligned;
+}
+
+/** Maps memory for a large block according to the policy */
+static void *
+map_big(size_t maplen)
+{
+	void *p = NULL;
+	size_t page = HUGE_PAGE_SZ;
+
+	if (alloc_policy & JSON_ALLOC_HUGETLB) {
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+# ifdef MAP_HUGE_2MB
+		/* maplen is a multiple of 2 MiB, which the system's default
+		 * huge page size (perhaps 1 GiB) need not divide */
+		flags |= MAP_HUGE_2MB;
+# endif
+		/* Reserved huge pages, which may be exhausted */
+		p = mmap(NULL, maplen, PROT_READ | PROT_WRITE, flags, -1, 0);
+		if (p == MAP_FAILED)
+			p = NULL;
+	}
+	if (!p) {
+		p = map_aligned(maplen);
+		if (!p)
+			return NULL;
+# ifdef MADV_HUGEPAGE
+		if (alloc_policy & (JSON_ALLOC_HUGE_PAGES | JSON_ALLOC_HUGETLB))
+			(void) madvise(p, maplen, MADV_HUGEPAGE);
+# endif
+		if (!(alloc_policy & (JSON_ALLOC_HUGE_PAGES |
+		    JSON_ALLOC_HUGETLB)))
+			page = sysconf(_SC_PAGESIZE);
+	}
+	if (alloc_policy & JSON_ALLOC_LOCAL) {
+		size_t i;
+		/* Prefer the calling thread's node, and fault the pages
+		 * in now, so that first touch places them there too */
+		(void) syscall(SYS_mbind, p, maplen, MPOL_LOCAL, NULL, 0, 0);
+		for (i = 0; i < maplen; i += page)
+			((volatile char *)p)[i] = 0;
+	}
+	return p;
+}
+#endif /* HAVE_MMAP */
+
+/** Allocates a block from the heap, aligned to a cache line */
+static union header *
+heap_alloc(size_t size)
+{
+	void *p;
+	int error = posix_memalign(&p, ALIGN, size);
+
+	if (error) {
+		errno = error;
+		return NULL;
+	}
+	return p;
+}
+
+/**
+ * Allocates a block of memory that may be large.
+ *
+ * Blocks of at least 2 MiB may be mapped with huge pages or bound
+ * to the local NUMA node, according to #json_set_alloc_policy().
+ * Other blocks come from the heap.
+ *
+ * @param len  the size of the block
+ *
+ * @returns a block aligned to 64 bytes, to be released with #big_free()
+ * @retval NULL [ENOMEM] Allocation failed.
+ */
+void *
+big_alloc(size_t len)
+{
+	union header *h = NULL;
+
+	if (len > SIZE_MAX - HUGE_PAGE_SZ - sizeof *h) {
+		errno = ENOMEM;
+		return NULL;
+	}
+#ifdef HAVE_MMAP
+	if (alloc_policy && len >= BIG_MIN) {
+		size_t maplen = (sizeof *h + len + HUGE_PAGE_SZ - 1) &
+		    ~(HUGE_PAGE_SZ - 1);
+		h = map_big(maplen);
+		if (h)
+			h->maplen = maplen;
+	}
+#endif
+	if (!h) {
+		h = heap_alloc(sizeof *h + len);
+		if (!h)
+			return NULL;
+		h->maplen = 0;
+	}
+	h->len = len;
+	return h + 1;
+}
+
+/**
+ * Resizes a block from #big_alloc().
+ *
+ * @param p    the block, or @c NULL
+ * @param len  the new size of the block
+ *
+ * @returns the resized block, which may have moved
+ * @retval NULL [ENOMEM] Allocation failed, and @a p is unchanged.
+ */
+void *
+big_realloc(void *p, size_t len)
+{
+	union header *h;
+	void *q;
+
+	if (!p)
+		return big_alloc(len);
+	h = (union header *)p - 1;
+	/* realloc() would not keep the alignment, so always copy */
+	q = big_alloc(len);
+	if (!q)
+		return NULL;
+	memcpy(q, p, len < h->len ? len : h->len);
+	big_free(p);
+	return q;
+}
+
+/** Releases a block from #big_alloc() or #big_realloc(). */
+void
+big_free(void *p)
+{
+	union header *h;
+
+	if (!p)
+		return;
+	h = (union header *)p - 1;
+#ifdef HAVE_MMAP
+	if (h->maplen) {
+		munmap(h, h->maplen);
+		return;
+	}
+#endif
+	free(h);
+}
+
+__PUBLIC
+unsigned
+json_set_alloc_policy(unsigned policy)
+{
+	unsigned old = alloc_policy;
+
+	alloc_policy = policy & (JSON_ALLOC_HUGE_PAGES | JSON_ALLOC_HUGETLB |
+	    JSON_ALLOC_LOCAL);
+	return old;
+}
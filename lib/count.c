@@ -0,0 +1,110 @@
+#include <errno.h>
+#include <string.h>
+
+#include "private.h"
+
+#define WHITESPACE " \t\n\r"
+
+/**
+ * Counts the members of an array or object without visiting them.
+ *
+ * Instead of skipping each member with #skip_value(), this jumps
+ * with @c strcspn() between the only characters that matter:
+ * brackets, braces, quotes and commas. Commas found outside of
+ * nested structures and strings separate the members, so the count
+ * is one more than the number of those commas. A trailing comma,
+ * which the iterators accept, is not counted.
+ *
+ * Like #json_array_next() and #json_object_next(), the members
+ * themselves are not validated.
+ *
+ * @param json   (optional) JSON text
+ * @param open   the opening character, '[' or '{'
+ * @param close  the matching closing character
+ *
+ * @returns the number of members
+ * @retval -1 [EINVAL] The value is not the expected structure,
+ *                     or is unterminated.
+ */
+static long
+count_members(const __JSON char *json, char open, char close)
+{
+	const __JSON char *p;
+	unsigned long depth = 0;
+	long commas = 0;
+
+	skip_white(&json);
+	if (!json || *json != open)
+		goto invalid;
+	p = json + 1;
+	skip_white(&p);
+	if (*p == close)
+		return 0;
+
+	for (;;) {
+		__JSON char ch;
+
+		p += strcspn(p, "[]{},\"'");
+		switch ((ch = *p++)) {
+		case '\0':
+			goto invalid; /* unterminated */
+		case '[':
+		case '{':
+			depth++;
+			break;
+		case ']':
+		case '}':
+			if (depth) {
+				depth--;
+				break;
+			}
+			if (ch != close)
+				goto invalid;
+			/* Don't count a trailing comma */
+			for (p -= 2; strchr(WHITESPACE, *p); p--)
+				;
+			return commas + (*p != ',');
+		case ',':
+			if (!depth)
+				commas++;
+			break;
+		case '\'':
+			/* Single quotes within words are word characters */
+			if (!is_delimiter(p[-2])) {
+				while (is_word_char(*p))
+					p++;
+				break;
+			}
+			/* FALLTHROUGH */
+		case '"':
+			/* Skip to the closing quote, over escapes */
+			for (;;) {
+				p += strcspn(p, ch == '"' ? "\"\\" : "'\\");
+				if (!*p)
+					goto invalid;
+				if (*p++ == ch)
+					break;
+				if (*p)
+					p++;
+			}
+			break;
+		}
+	}
+invalid:
+	errno = EINVAL;
+	return -1;
+}
+
+__PUBLIC
+long
+json_array_length(const __JSON char *json)
+{
+	return count_members(json, '[', ']');
+}
+
+__PUBLIC
+long
+json_object_size(const __JSON char *json)
+{
+	return count_members(json, '{', '}');
+}
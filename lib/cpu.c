@@ -0,0 +1,595 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "private.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define HAVE_X86_KERNELS
+# include <immintrin.h>
+#endif
+
+/* The variants of the kernels, in order of preference */
+enum variant {
+	VARIANT_SCALAR,		/* a byte at a time */
+	VARIANT_SWAR,		/* eight bytes at a time, in a uint64_t */
+	VARIANT_SSE2,
+	VARIANT_AVX2,
+	VARIANT_AVX512
+};
+
+/* The names used by the REDJSON_CPU environment variable */
+static const char *const variant_names[] = {
+	"scalar", "swar", "sse2", "avx2", "avx512"
+};
+
+/** Tests if a byte is plain ASCII, for #ascii_span() */
+#define IS_PLAIN(ch, stop)						\
+	((ch) >= 0x20 && (ch) < 0x80 && (ch) != (stop)[0] &&		\
+	 (ch) != (stop)[1] && (ch) != (stop)[2] && (ch) != (stop)[3])
+
+static size_t
+ascii_span_scalar(const char *p, size_t len, const char *stop)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		unsigned char ch = p[i];
+		if (!IS_PLAIN(ch, stop))
+			break;
+	}
+	return i;
+}
+
+/** Returns a word with the high bit set in each byte that is zero */
+static uint64_t
+zero_bytes(uint64_t word)
+{
+	const uint64_t ones = 0x0101010101010101ULL;
+
+	return (word - ones) & ~word & (ones << 7);
+}
+
+static size_t
+ascii_span_swar(const char *p, size_t len, const char *stop)
+{
+	const uint64_t ones = 0x0101010101010101ULL;
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		uint64_t word;
+		uint64_t bad;
+		memcpy(&word, p + i, sizeof word);
+		/* High bytes, controls (below 0x20) and stop bytes */
+		bad = (word & (ones << 7)) |
+		    zero_bytes(word & (ones * 0x60)) |
+		    zero_bytes(word ^ (ones * (unsigned char)stop[0])) |
+		    zero_bytes(word ^ (ones * (unsigned char)stop[1])) |
+		    zero_bytes(word ^ (ones * (unsigned char)stop[2])) |
+		    zero_bytes(word ^ (ones * (unsigned char)stop[3]));
+		if (bad)
+			break;
+	}
+	return i + ascii_span_scalar(p + i, len - i, stop);
+}
+
+static size_t
+byte_span_scalar(const char *p, size_t len, const char *stop)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		if (p[i] == stop[0] || p[i] == stop[1] || p[i] == stop[2] ||
+		    p[i] == stop[3])
+			break;
+	return i;
+}
+
+static size_t
+byte_span_swar(const char *p, size_t len, const char *stop)
+{
+	const uint64_t ones = 0x0101010101010101ULL;
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		uint64_t word;
+		uint64_t found;
+		memcpy(&word, p + i, sizeof word);
+		found = zero_bytes(word ^ (ones * (unsigned char)stop[0])) |
+		    zero_bytes(word ^ (ones * (unsigned char)stop[1])) |
+		    zero_bytes(word ^ (ones * (unsigned char)stop[2])) |
+		    zero_bytes(word ^ (ones * (unsigned char)stop[3]));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		/* The lowest flag is exact; only flags above it can
+		 * be borrows */
+		if (found)
+			return i + __builtin_ctzll(found) / 8;
+#else
+		if (found)
+			break;
+#endif
+	}
+	return i + byte_span_scalar(p + i, len - i, stop);
+}
+
+static void
+hex_encode_scalar(const unsigned char *src, size_t n, char *dst)
+{
+	while (n--) {
+		*dst++ = hex_to_char[*src >> 4];
+		*dst++ = hex_to_char[*src++ & 0xf];
+	}
+}
+
+static void
+hex_encode_swar(const unsigned char *src, size_t n, char *dst)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	const uint64_t ones = 0x0101010101010101ULL;
+	const uint64_t low = 0x000f000f000f000fULL;
+
+	for (; n >= 4; n -= 4, src += 4, dst += 8) {
+		uint32_t in;
+		uint64_t word, digits;
+		memcpy(&in, src, sizeof in);
+		/* Each byte to its own 16-bit lane, then its high digit
+		 * to the lane's first byte and its low digit after */
+		word = in;
+		word = (word | word << 16) & 0x0000ffff0000ffffULL;
+		word = (word | word << 8) & 0x00ff00ff00ff00ffULL;
+		digits = (word >> 4 & low) | (word & low) << 8;
+		/* Digits of 10 and up carry into bit 7 when 0x76 is added */
+		word = digits + ones * '0' +
+		    ((digits + ones * 0x76) >> 7 & ones) * ('a' - '0' - 10);
+		memcpy(dst, &word, sizeof word);
+	}
+#endif
+	hex_encode_scalar(src, n, dst);
+}
+
+/* Encodes the whole groups of three bytes */
+static void
+base64_encode_scalar(const unsigned char *src, size_t n, char *dst)
+{
+	for (; n >= 3; n -= 3, src += 3) {
+		/* 00000000 11111111 22222222 */
+		/* aaaaaabb bbbbcccc ccdddddd */
+		*dst++ = base64_to_char[src[0] >> 2];
+		*dst++ = base64_to_char[(src[0] << 4 | src[1] >> 4) & 63];
+		*dst++ = base64_to_char[(src[1] << 2 | src[2] >> 6) & 63];
+		*dst++ = base64_to_char[src[2] & 63];
+	}
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("sse2")))
+static size_t
+ascii_span_sse2(const char *p, size_t len, const char *stop)
+{
+	const __m128i controls = _mm_set1_epi8(0x1f);
+	const __m128i s0 = _mm_set1_epi8(stop[0]);
+	const __m128i s1 = _mm_set1_epi8(stop[1]);
+	const __m128i s2 = _mm_set1_epi8(stop[2]);
+	const __m128i s3 = _mm_set1_epi8(stop[3]);
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		/* As signed bytes, plain ASCII is greater than 0x1f */
+		__m128i plain = _mm_cmpgt_epi8(v, controls);
+		__m128i stops = _mm_or_si128(
+		    _mm_or_si128(_mm_cmpeq_epi8(v, s0),
+			_mm_cmpeq_epi8(v, s1)),
+		    _mm_or_si128(_mm_cmpeq_epi8(v, s2),
+			_mm_cmpeq_epi8(v, s3)));
+		unsigned mask = _mm_movemask_epi8(
+		    _mm_andnot_si128(stops, plain));
+		if (mask != 0xffff)
+			return i + __builtin_ctz(~mask);
+	}
+	return i + ascii_span_scalar(p + i, len - i, stop);
+}
+
+__attribute__((target("avx2")))
+static size_t
+ascii_span_avx2(const char *p, size_t len, const char *stop)
+{
+	const __m256i controls = _mm256_set1_epi8(0x1f);
+	const __m256i s0 = _mm256_set1_epi8(stop[0]);
+	const __m256i s1 = _mm256_set1_epi8(stop[1]);
+	const __m256i s2 = _mm256_set1_epi8(stop[2]);
+	const __m256i s3 = _mm256_set1_epi8(stop[3]);
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+		__m256i plain = _mm256_cmpgt_epi8(v, controls);
+		__m256i stops = _mm256_or_si256(
+		    _mm256_or_si256(_mm256_cmpeq_epi8(v, s0),
+			_mm256_cmpeq_epi8(v, s1)),
+		    _mm256_or_si256(_mm256_cmpeq_epi8(v, s2),
+			_mm256_cmpeq_epi8(v, s3)));
+		unsigned mask = _mm256_movemask_epi8(
+		    _mm256_andnot_si256(stops, plain));
+		if (mask != 0xffffffff)
+			return i + __builtin_ctz(~mask);
+	}
+	/* Avoid the penalty for mixing AVX and legacy SSE code */
+	_mm256_zeroupper();
+	return i + ascii_span_sse2(p + i, len - i, stop);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t
+ascii_span_avx512(const char *p, size_t len, const char *stop)
+{
+	const __m512i controls = _mm512_set1_epi8(0x1f);
+	const __m512i s0 = _mm512_set1_epi8(stop[0]);
+	const __m512i s1 = _mm512_set1_epi8(stop[1]);
+	const __m512i s2 = _mm512_set1_epi8(stop[2]);
+	const __m512i s3 = _mm512_set1_epi8(stop[3]);
+	size_t i = 0;
+
+	for (; i + 64 <= len; i += 64) {
+		__m512i v = _mm512_loadu_si512((const void *)(p + i));
+		__mmask64 plain = _mm512_cmpgt_epi8_mask(v, controls) &
+		    ~(_mm512_cmpeq_epi8_mask(v, s0) |
+		      _mm512_cmpeq_epi8_mask(v, s1) |
+		      _mm512_cmpeq_epi8_mask(v, s2) |
+		      _mm512_cmpeq_epi8_mask(v, s3));
+		if (plain != ~(__mmask64)0)
+			return i + __builtin_ctzll(~plain);
+	}
+	return i + ascii_span_avx2(p + i, len - i, stop);
+}
+
+__attribute__((target("sse2")))
+static size_t
+byte_span_sse2(const char *p, size_t len, const char *stop)
+{
+	const __m128i s0 = _mm_set1_epi8(stop[0]);
+	const __m128i s1 = _mm_set1_epi8(stop[1]);
+	const __m128i s2 = _mm_set1_epi8(stop[2]);
+	const __m128i s3 = _mm_set1_epi8(stop[3]);
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		unsigned mask = _mm_movemask_epi8(_mm_or_si128(
+		    _mm_or_si128(_mm_cmpeq_epi8(v, s0),
+			_mm_cmpeq_epi8(v, s1)),
+		    _mm_or_si128(_mm_cmpeq_epi8(v, s2),
+			_mm_cmpeq_epi8(v, s3))));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	return i + byte_span_scalar(p + i, len - i, stop);
+}
+
+__attribute__((target("avx2")))
+static size_t
+byte_span_avx2(const char *p, size_t len, const char *stop)
+{
+	const __m256i s0 = _mm256_set1_epi8(stop[0]);
+	const __m256i s1 = _mm256_set1_epi8(stop[1]);
+	const __m256i s2 = _mm256_set1_epi8(stop[2]);
+	const __m256i s3 = _mm256_set1_epi8(stop[3]);
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+		unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(
+		    _mm256_or_si256(_mm256_cmpeq_epi8(v, s0),
+			_mm256_cmpeq_epi8(v, s1)),
+		    _mm256_or_si256(_mm256_cmpeq_epi8(v, s2),
+			_mm256_cmpeq_epi8(v, s3))));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	_mm256_zeroupper();
+	return i + byte_span_sse2(p + i, len - i, stop);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t
+byte_span_avx512(const char *p, size_t len, const char *stop)
+{
+	const __m512i s0 = _mm512_set1_epi8(stop[0]);
+	const __m512i s1 = _mm512_set1_epi8(stop[1]);
+	const __m512i s2 = _mm512_set1_epi8(stop[2]);
+	const __m512i s3 = _mm512_set1_epi8(stop[3]);
+	size_t i = 0;
+
+	for (; i + 64 <= len; i += 64) {
+		__m512i v = _mm512_loadu_si512((const void *)(p + i));
+		__mmask64 found = _mm512_cmpeq_epi8_mask(v, s0) |
+		    _mm512_cmpeq_epi8_mask(v, s1) |
+		    _mm512_cmpeq_epi8_mask(v, s2) |
+		    _mm512_cmpeq_epi8_mask(v, s3);
+		if (found)
+			return i + __builtin_ctzll(found);
+	}
+	return i + byte_span_avx2(p + i, len - i, stop);
+}
+
+/** Converts bytes holding 0..15 to hexadecimal digits */
+__attribute__((target("sse2")))
+static __m128i
+hex_digits_sse2(__m128i v)
+{
+	__m128i letters = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(9)),
+	    _mm_set1_epi8('a' - '0' - 10));
+
+	return _mm_add_epi8(_mm_add_epi8(v, _mm_set1_epi8('0')), letters);
+}
+
+__attribute__((target("sse2")))
+static void
+hex_encode_sse2(const unsigned char *src, size_t n, char *dst)
+{
+	const __m128i low = _mm_set1_epi8(0xf);
+
+	for (; n >= 16; n -= 16, src += 16, dst += 32) {
+		__m128i v = _mm_loadu_si128((const __m128i *)src);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low);
+		__m128i lo = _mm_and_si128(v, low);
+
+		_mm_storeu_si128((__m128i *)dst,
+		    hex_digits_sse2(_mm_unpacklo_epi8(hi, lo)));
+		_mm_storeu_si128((__m128i *)(dst + 16),
+		    hex_digits_sse2(_mm_unpackhi_epi8(hi, lo)));
+	}
+	hex_encode_scalar(src, n, dst);
+}
+
+__attribute__((target("avx2")))
+static void
+hex_encode_avx2(const unsigned char *src, size_t n, char *dst)
+{
+	const __m256i low = _mm256_set1_epi8(0xf);
+	const __m256i digits = _mm256_broadcastsi128_si256(
+	    _mm_loadu_si128((const __m128i *)hex_to_char));
+
+	for (; n >= 32; n -= 32, src += 32, dst += 64) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)src);
+		__m256i hi = _mm256_shuffle_epi8(digits,
+		    _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+		__m256i lo = _mm256_shuffle_epi8(digits,
+		    _mm256_and_si256(v, low));
+		/* Unpacking interleaves within each 128-bit lane */
+		__m256i a = _mm256_unpacklo_epi8(hi, lo);
+		__m256i b = _mm256_unpackhi_epi8(hi, lo);
+
+		_mm256_storeu_si256((__m256i *)dst,
+		    _mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_storeu_si256((__m256i *)(dst + 32),
+		    _mm256_permute2x128_si256(a, b, 0x31));
+	}
+	_mm256_zeroupper();
+	hex_encode_sse2(src, n, dst);
+}
+
+/*
+ * Encodes 24 bytes to 32 digits at a time, after Wojciech Mula's
+ * method: each lane gathers three bytes into each 32-bit word, the
+ * multiplies move the four 6-bit fields of each word into bytes, and
+ * a shuffle looks up the offset from each field to its digit.
+ */
+__attribute__((target("avx2")))
+static void
+base64_encode_avx2(const unsigned char *src, size_t n, char *dst)
+{
+	const __m256i gather = _mm256_setr_epi8(
+	    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+	    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	const __m256i offsets = _mm256_setr_epi8(
+	    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+	    '/' - 63, 'A', 0, 0,
+	    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+	    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+	    '/' - 63, 'A', 0, 0);
+
+	/* Each lane loads 16 bytes for the 12 it encodes */
+	for (; n >= 28; n -= 24, src += 24, dst += 32) {
+		__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(
+		    _mm_loadu_si128((const __m128i *)src)),
+		    _mm_loadu_si128((const __m128i *)(src + 12)), 1);
+		__m256i fields, range;
+
+		v = _mm256_shuffle_epi8(v, gather);
+		fields = _mm256_or_si256(
+		    _mm256_mulhi_epu16(
+			_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)),
+			_mm256_set1_epi32(0x04000040)),
+		    _mm256_mullo_epi16(
+			_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)),
+			_mm256_set1_epi32(0x01000010)));
+		/* 0..25 to 13, 26..51 to 0, and 52..63 to 1..12 */
+		range = _mm256_or_si256(
+		    _mm256_subs_epu8(fields, _mm256_set1_epi8(51)),
+		    _mm256_and_si256(
+			_mm256_cmpgt_epi8(_mm256_set1_epi8(26), fields),
+			_mm256_set1_epi8(13)));
+		_mm256_storeu_si256((__m256i *)dst, _mm256_add_epi8(fields,
+		    _mm256_shuffle_epi8(offsets, range)));
+	}
+	_mm256_zeroupper();
+	base64_encode_scalar(src, n, dst);
+}
+#endif /* HAVE_X86_KERNELS */
+
+/** Returns the best kernel variant supported by this CPU */
+static enum variant
+detect_variant(void)
+{
+#ifdef HAVE_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512bw"))
+		return VARIANT_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return VARIANT_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return VARIANT_SSE2;
+#endif
+	return VARIANT_SWAR;
+}
+
+/**
+ * Chooses the kernel variant, once.
+ *
+ * The best variant the CPU supports is used, unless the environment
+ * variable @c REDJSON_CPU names a lesser one. Threads that race to
+ * choose will all choose the same variant, and store it atomically.
+ */
+static enum variant
+chosen_variant(void)
+{
+	static int chosen = -1;
+	int c = __atomic_load_n(&chosen, __ATOMIC_RELAXED);
+
+	if (c < 0) {
+		enum variant v = detect_variant();
+		const char *env = getenv("REDJSON_CPU");
+		int i;
+
+		if (env)
+			for (i = 0; i <= VARIANT_AVX512; i++)
+				if (strcmp(env, variant_names[i]) == 0 &&
+				    i < (int)v)
+					v = i;
+		c = v;
+		__atomic_store_n(&chosen, c, __ATOMIC_RELAXED);
+	}
+	return c;
+}
+
+/* The kernels of one variant */
+struct kernels {
+	size_t (*ascii_span)(const char *, size_t, const char *);
+	size_t (*byte_span)(const char *, size_t, const char *);
+	void (*hex_encode)(const unsigned char *, size_t, char *);
+	void (*base64_encode)(const unsigned char *, size_t, char *);
+};
+
+/*
+ * The kernels of each variant, indexed by enum variant. Base-64
+ * needs a byte shuffle, which SSE2 lacks, and AVX-512BW would need
+ * VBMI for its wider one, so those variants use the nearest lesser
+ * encoder.
+ */
+static const struct kernels variant_kernels[] = {
+	{ ascii_span_scalar, byte_span_scalar, hex_encode_scalar,
+	  base64_encode_scalar },
+	{ ascii_span_swar, byte_span_swar, hex_encode_swar,
+	  base64_encode_scalar },
+#ifdef HAVE_X86_KERNELS
+	{ ascii_span_sse2, byte_span_sse2, hex_encode_sse2,
+	  base64_encode_scalar },
+	{ ascii_span_avx2, byte_span_avx2, hex_encode_avx2,
+	  base64_encode_avx2 },
+	{ ascii_span_avx512, byte_span_avx512, hex_encode_avx2,
+	  base64_encode_avx2 },
+#endif
+};
+
+/**
+ * Returns the kernels of the chosen variant.
+ *
+ * They are chosen on first use. Threads may race to choose them,
+ * so the pointer is loaded and stored atomically.
+ */
+static const struct kernels *
+kernels(void)
+{
+	static const struct kernels *chosen;
+	const struct kernels *k = __atomic_load_n(&chosen, __ATOMIC_RELAXED);
+
+	if (!k) {
+		k = &variant_kernels[chosen_variant()];
+		__atomic_store_n(&chosen, k, __ATOMIC_RELAXED);
+	}
+	return k;
+}
+
+/**
+ * Measures a run of plain ASCII text.
+ *
+ * Plain ASCII is U+0020..U+007F, excluding the stop characters.
+ * This is the hot loop of #span_utf8() and #json_transcode(),
+ * and uses the widest vector instructions the CPU has.
+ *
+ * @param p     the text, which need not be NUL-terminated
+ * @param len   the length of the text
+ * @param stop  four ASCII characters that end the run.
+ *              Unused entries should be NUL.
+ *
+ * @returns the length of the run
+ */
+size_t
+ascii_span(const char *p, size_t len, const char stop[4])
+{
+	return kernels()->ascii_span(p, len, stop);
+}
+
+/**
+ * Measures a run of bytes other than the stop bytes.
+ *
+ * Unlike #ascii_span(), any other byte continues the run, so this
+ * skips the inside of a string without stopping at UTF-8.
+ *
+ * @param p     the text, which need not be NUL-terminated
+ * @param len   the length of the text
+ * @param stop  four bytes that end the run.
+ *              Unused entries should be NUL.
+ *
+ * @returns the length of the run
+ */
+size_t
+byte_span(const char *p, size_t len, const char stop[4])
+{
+	return kernels()->byte_span(p, len, stop);
+}
+
+/**
+ * Writes two lowercase hexadecimal digits for each byte.
+ *
+ * @param src  the bytes
+ * @param n    the number of bytes
+ * @param dst  storage for @a n * 2 digits, which are not terminated
+ */
+void
+hex_encode(const unsigned char *src, size_t n, char *dst)
+{
+	kernels()->hex_encode(src, n, dst);
+}
+
+/**
+ * Writes four base-64 digits for each whole group of three bytes.
+ *
+ * @param src  the bytes
+ * @param n    the number of bytes, of which the last @a n % 3
+ *             are left for the caller to encode and pad
+ * @param dst  storage for @a n / 3 * 4 digits, which are not
+ *             terminated
+ */
+void
+base64_encode(const unsigned char *src, size_t n, char *dst)
+{
+	kernels()->base64_encode(src, n, dst);
+}
+
+__PUBLIC
+unsigned
+json_cpu_features(void)
+{
+	switch (chosen_variant()) {
+	case VARIANT_AVX512:
+		return JSON_CPU_SSE2 | JSON_CPU_AVX2 | JSON_CPU_AVX512;
+	case VARIANT_AVX2:
+		return JSON_CPU_SSE2 | JSON_CPU_AVX2;
+	case VARIANT_SSE2:
+		return JSON_CPU_SSE2;
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,257 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include "private.h"
+
+#define MAX_DECIMAL64_SCALE	18
+#define MAX_DECIMAL128_DIGITS	34
+#define DECIMAL128_EMIN		(-6176)	/* smallest exponent of decimal128 */
+#define DECIMAL128_EMAX		6111	/* largest exponent of decimal128 */
+#define LIMB			100000000000000000ULL	/* 10^17 */
+
+/* The decimal digits of a strict JSON number, located in the text */
+struct decimal_text {
+	int negative;
+	const __JSON char *ip;	/* integer digits */
+	int ilen;
+	const __JSON char *fp;	/* fraction digits, after the '.' */
+	int flen;
+	long exponent;		/* the 'e' exponent, clamped */
+};
+
+/** Returns the i'th digit of a decimal text as an integer. */
+static int
+digit_at(const struct decimal_text *dt, int i)
+{
+	return (i < dt->ilen ? dt->ip[i] : dt->fp[i - dt->ilen]) - '0';
+}
+
+/**
+ * Locates the parts of a JSON number, which may be quoted.
+ *
+ * @param json  (optional) JSON text
+ * @param dt    storage for the located number
+ *
+ * @retval 1 The text is a strict JSON number.
+ * @retval 1 [EINVAL] The text is a quoted strict JSON number.
+ * @retval 0 [EINVAL] The text is not a number.
+ */
+static int
+scan_decimal(const __JSON char *json, struct decimal_text *dt)
+{
+	const __JSON char *end;
+	__JSON char quote = 0;
+
+	if (!json)
+		goto invalid;
+	skip_white(&json);
+	if (*json == '"' || *json == '\'')
+		quote = *json++;
+	end = scan_strict_number(json);
+	if (!end || (quote && *end != quote))
+		goto invalid;
+
+	dt->negative = (*json == '-');
+	if (dt->negative)
+		json++;
+	dt->ip = json;
+	while (isdigit(*json))
+		json++;
+	dt->ilen = json - dt->ip;
+	dt->fp = json;
+	dt->flen = 0;
+	if (*json == '.') {
+		dt->fp = ++json;
+		while (isdigit(*json))
+			json++;
+		dt->flen = json - dt->fp;
+	}
+	dt->exponent = 0;
+	if (*json == 'e' || *json == 'E') {
+		int eneg = 0;
+		json++;
+		if (*json == '-' || *json == '+')
+			eneg = (*json++ == '-');
+		while (isdigit(*json)) {
+			if (dt->exponent < 1000000)
+				dt->exponent = dt->exponent * 10 +
+				    (*json - '0');
+			json++;
+		}
+		if (eneg)
+			dt->exponent = -dt->exponent;
+	}
+	if (quote)
+		errno = EINVAL;
+	return 1;
+invalid:
+	errno = EINVAL;
+	return 0;
+}
+
+__PUBLIC
+int64_t
+json_as_decimal64(const __JSON char *json, int scale)
+{
+	struct decimal_text dt;
+	uint64_t limit;
+	uint64_t acc = 0;
+	long kept;		/* number of digits at or above 10^-scale */
+	int ndigits;
+	int inexact = 0;
+	int i;
+
+	if (scale < 0 || scale > MAX_DECIMAL64_SCALE) {
+		errno = EINVAL;
+		return 0;
+	}
+	if (!scan_decimal(json, &dt))
+		return 0;
+	limit = dt.negative ? (uint64_t)INT64_MAX + 1 : INT64_MAX;
+
+	/* The digits are scaled by 10^(exponent + scale), so only
+	 * those before the (exponent + scale)'th fraction digit
+	 * remain in the integer result. */
+	ndigits = dt.ilen + dt.flen;
+	kept = dt.ilen + dt.exponent + scale;
+	for (i = 0; i < ndigits; i++) {
+		int d = digit_at(&dt, i);
+		if (i >= kept) {
+			if (d)
+				inexact = 1;
+			continue;
+		}
+		if (acc > (limit - d) / 10)
+			goto overflow;
+		acc = acc * 10 + d;
+	}
+	/* Trailing zeros implied by the exponent */
+	for (; i < kept && acc; i++) {
+		if (acc > limit / 10)
+			goto overflow;
+		acc *= 10;
+	}
+	if (inexact)
+		errno = ERANGE;
+	return dt.negative ? (int64_t)(0 - acc) : (int64_t)acc;
+overflow:
+	errno = ERANGE;
+	return dt.negative ? INT64_MIN : INT64_MAX;
+}
+
+__PUBLIC
+int
+json_as_decimal128(const __JSON char *json, struct json_decimal128 *d)
+{
+	struct decimal_text dt;
+	long exponent;
+	int ndigits;
+	int count = 0;		/* significant digits in the coefficient */
+	int inexact = 0;
+	int i;
+
+	if (!scan_decimal(json, &dt))
+		return -1;
+
+	d->negative = dt.negative;
+	d->hi = 0;
+	d->lo = 0;
+	exponent = dt.exponent - dt.flen;
+	ndigits = dt.ilen + dt.flen;
+	for (i = 0; i < ndigits; i++) {
+		int digit = digit_at(&dt, i);
+		if (count == MAX_DECIMAL128_DIGITS) {
+			/* Digits beyond the precision are truncated */
+			if (digit)
+				inexact = 1;
+			exponent++;
+			continue;
+		}
+		d->lo = d->lo * 10 + digit;
+		d->hi = d->hi * 10 + d->lo / LIMB;
+		d->lo %= LIMB;
+		if (count || digit)
+			count++;
+	}
+	if (!d->hi && !d->lo) {
+		/* Zeros are clamped silently */
+		if (exponent < DECIMAL128_EMIN)
+			exponent = DECIMAL128_EMIN;
+		if (exponent > DECIMAL128_EMAX)
+			exponent = DECIMAL128_EMAX;
+	}
+	/* Large exponents move into the coefficient as trailing zeros,
+	 * while it has room for them */
+	while (exponent > DECIMAL128_EMAX && count < MAX_DECIMAL128_DIGITS) {
+		d->lo *= 10;
+		d->hi = d->hi * 10 + d->lo / LIMB;
+		d->lo %= LIMB;
+		count++;
+		exponent--;
+	}
+	/* Small exponents take trailing zeros from the coefficient */
+	while (exponent < DECIMAL128_EMIN && d->lo % 10 == 0) {
+		d->lo = (d->hi % 10 * LIMB + d->lo) / 10;
+		d->hi /= 10;
+		count--;
+		exponent++;
+	}
+	if (exponent < DECIMAL128_EMIN || exponent > DECIMAL128_EMAX) {
+		d->exponent = exponent < 0 ? DECIMAL128_EMIN : DECIMAL128_EMAX;
+		errno = ERANGE;
+		return -1;
+	}
+	d->exponent = exponent;
+	if (inexact) {
+		errno = ERANGE;
+		return -1;
+	}
+	return 0;
+}
+
+__PUBLIC
+size_t
+json_from_decimal64(int64_t value, int scale, __JSON char *dst, size_t dstsz)
+{
+	char digits[JSON_FROM_DECIMAL64_SZ];
+	char *p = digits + sizeof digits;
+	uint64_t u;
+	size_t ndigits;
+	size_t outlen;
+	size_t i;
+
+	if (scale < 0 || scale > MAX_DECIMAL64_SCALE) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	/* Collect the digits backwards, with at least one
+	 * integer digit before the fraction digits */
+	u = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+	do {
+		*--p = '0' + u % 10;
+		u /= 10;
+	} while (u);
+	while (digits + sizeof digits - p <= scale)
+		*--p = '0';
+	ndigits = digits + sizeof digits - p;
+
+	outlen = (value < 0) + ndigits + (scale > 0) + 1;
+	if (!dstsz)
+		return outlen;
+	if (outlen > dstsz) {
+		errno = ENOMEM;
+		*dst = '\0';
+		return 0;
+	}
+	if (value < 0)
+		*dst++ = '-';
+	for (i = 0; i < ndigits; i++) {
+		if (i == ndigits - scale)
+			*dst++ = '.';
+		*dst++ = p[i];
+	}
+	*dst = '\0';
+	return outlen;
+}
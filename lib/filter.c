@@ -0,0 +1,84 @@
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "private.h"
+
+#define FILTER_BITS	(64 * (sizeof ((struct json_key_filter *)0)->bits \
+			      / sizeof (uint64_t)))
+
+/* Each key sets three bits, taken from separate parts of its hash */
+#define PROBE(h, i)	(((h) >> (16 * (i))) % FILTER_BITS)
+
+/** Sets the bits of a key's hash in the filter. */
+static void
+filter_add(struct json_key_filter *f, uint64_t h)
+{
+	int i;
+
+	for (i = 0; i < 3; i++)
+		f->bits[PROBE(h, i) / 64] |= (uint64_t)1 << (PROBE(h, i) % 64);
+}
+
+/** Tests if all the bits of a key's hash are set in the filter. */
+static int
+filter_test(const struct json_key_filter *f, uint64_t h)
+{
+	int i;
+
+	for (i = 0; i < 3; i++)
+		if (!(f->bits[PROBE(h, i) / 64] &
+		    ((uint64_t)1 << (PROBE(h, i) % 64))))
+			return 0;
+	return 1;
+}
+
+__PUBLIC
+int
+json_key_filter_init(struct json_key_filter *f, const __JSON char *json)
+{
+	const __JSON_OBJECTI char *ji;
+	const __JSON char *key;
+	int save_errno = errno;
+
+	memset(f, 0, sizeof *f);
+	ji = json_as_object(json);
+	if (!ji)
+		return -1;
+	errno = 0;
+	while (json_object_next(&ji, &key))
+		filter_add(f, hash_json_key(key));
+	if (!ji) {
+		if (!errno)
+			errno = EINVAL;
+		return -1;
+	}
+	f->object = json;
+	errno = save_errno;
+	return 0;
+}
+
+__PUBLIC
+int
+json_key_filter_test(const struct json_key_filter *f, const char *key)
+{
+	return filter_test(f, hash_bytes(key, strlen(key)));
+}
+
+__PUBLIC
+const __JSON char *
+json_key_filter_get(const struct json_key_filter *f, const char *key)
+{
+	struct path_component pc;
+	size_t keylen = strlen(key);
+
+	if (!f->object || !filter_test(f, hash_bytes(key, keylen))) {
+		errno = ENOENT;
+		return NULL;
+	}
+	pc.key = key;
+	pc.keylen = keylen;
+	pc.index = 0;
+	pc.fold = 0;
+	return select_component(f->object, &pc);
+}
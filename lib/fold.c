@@ -0,0 +1,304 @@
+#include <string.h>
+
+#include "private.h"
+#include "utf8.h"
+
+/* ASCII letters folded to lower case, as a table for the fast path */
+static const unsigned char ascii_fold[128] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+	0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	' ',  '!',  '"',  '#',  '$',  '%',  '&',  '\'',
+	'(',  ')',  '*',  '+',  ',',  '-',  '.',  '/',
+	'0',  '1',  '2',  '3',  '4',  '5',  '6',  '7',
+	'8',  '9',  ':',  ';',  '<',  '=',  '>',  '?',
+	'@',  'a',  'b',  'c',  'd',  'e',  'f',  'g',
+	'h',  'i',  'j',  'k',  'l',  'm',  'n',  'o',
+	'p',  'q',  'r',  's',  't',  'u',  'v',  'w',
+	'x',  'y',  'z',  '[',  '\\', ']',  '^',  '_',
+	'`',  'a',  'b',  'c',  'd',  'e',  'f',  'g',
+	'h',  'i',  'j',  'k',  'l',  'm',  'n',  'o',
+	'p',  'q',  'r',  's',  't',  'u',  'v',  'w',
+	'x',  'y',  'z',  '{',  '|',  '}',  '~',  0x7f,
+};
+
+/*
+ * Ranges of upper-case letters and the offset to their lower case.
+ * Ranges with step 2 hold alternating upper and lower case letters,
+ * starting with an upper-case letter.
+ */
+static const struct fold_range {
+	ucode first, last;
+	unsigned step;
+	int offset;
+} fold_ranges[] = {
+	{ 0x00b5, 0x00b5, 1, 0x03bc - 0x00b5 },	/* micro sign */
+	{ 0x00c0, 0x00d6, 1, 32 },		/* Latin-1 */
+	{ 0x00d8, 0x00de, 1, 32 },
+	{ 0x0100, 0x012e, 2, 1 },		/* Latin Extended-A */
+	{ 0x0132, 0x0136, 2, 1 },
+	{ 0x0139, 0x0147, 2, 1 },
+	{ 0x014a, 0x0176, 2, 1 },
+	{ 0x0178, 0x0178, 1, 0x00ff - 0x0178 },
+	{ 0x0179, 0x017d, 2, 1 },
+	{ 0x017f, 0x017f, 1, 's' - 0x017f },	/* long s */
+	{ 0x0181, 0x0181, 1, 0x0253 - 0x0181 },	/* Latin Extended-B */
+	{ 0x0182, 0x0184, 2, 1 },
+	{ 0x0186, 0x0186, 1, 0x0254 - 0x0186 },
+	{ 0x0187, 0x0187, 1, 1 },
+	{ 0x0189, 0x018a, 1, 205 },
+	{ 0x018b, 0x018b, 1, 1 },
+	{ 0x018e, 0x018e, 1, 0x01dd - 0x018e },
+	{ 0x018f, 0x018f, 1, 0x0259 - 0x018f },
+	{ 0x0190, 0x0190, 1, 0x025b - 0x0190 },
+	{ 0x0191, 0x0191, 1, 1 },
+	{ 0x0193, 0x0193, 1, 0x0260 - 0x0193 },
+	{ 0x0194, 0x0194, 1, 0x0263 - 0x0194 },
+	{ 0x0196, 0x0196, 1, 0x0269 - 0x0196 },
+	{ 0x0197, 0x0197, 1, 0x0268 - 0x0197 },
+	{ 0x0198, 0x0198, 1, 1 },
+	{ 0x019c, 0x019c, 1, 0x026f - 0x019c },
+	{ 0x019d, 0x019d, 1, 0x0272 - 0x019d },
+	{ 0x019f, 0x019f, 1, 0x0275 - 0x019f },
+	{ 0x01a0, 0x01a4, 2, 1 },
+	{ 0x01a6, 0x01a6, 1, 0x0280 - 0x01a6 },
+	{ 0x01a7, 0x01a7, 1, 1 },
+	{ 0x01a9, 0x01a9, 1, 0x0283 - 0x01a9 },
+	{ 0x01ac, 0x01ac, 1, 1 },
+	{ 0x01ae, 0x01ae, 1, 0x0288 - 0x01ae },
+	{ 0x01af, 0x01af, 1, 1 },
+	{ 0x01b1, 0x01b2, 1, 217 },
+	{ 0x01b3, 0x01b5, 2, 1 },
+	{ 0x01b7, 0x01b7, 1, 0x0292 - 0x01b7 },
+	{ 0x01b8, 0x01b8, 1, 1 },
+	{ 0x01bc, 0x01bc, 1, 1 },
+	{ 0x01c4, 0x01c4, 1, 2 },
+	{ 0x01c5, 0x01c5, 1, 1 },
+	{ 0x01c7, 0x01c7, 1, 2 },
+	{ 0x01c8, 0x01c8, 1, 1 },
+	{ 0x01ca, 0x01ca, 1, 2 },
+	{ 0x01cb, 0x01db, 2, 1 },
+	{ 0x01de, 0x01ee, 2, 1 },
+	{ 0x01f1, 0x01f1, 1, 2 },
+	{ 0x01f2, 0x01f4, 2, 1 },
+	{ 0x01f6, 0x01f6, 1, 0x0195 - 0x01f6 },
+	{ 0x01f7, 0x01f7, 1, 0x01bf - 0x01f7 },
+	{ 0x01f8, 0x021e, 2, 1 },
+	{ 0x0220, 0x0220, 1, 0x019e - 0x0220 },
+	{ 0x0222, 0x0232, 2, 1 },
+	{ 0x023a, 0x023a, 1, 0x2c65 - 0x023a },
+	{ 0x023b, 0x023b, 1, 1 },
+	{ 0x023d, 0x023d, 1, 0x019a - 0x023d },
+	{ 0x023e, 0x023e, 1, 0x2c66 - 0x023e },
+	{ 0x0241, 0x0241, 1, 1 },
+	{ 0x0243, 0x0243, 1, 0x0180 - 0x0243 },
+	{ 0x0244, 0x0244, 1, 0x0289 - 0x0244 },
+	{ 0x0245, 0x0245, 1, 0x028c - 0x0245 },
+	{ 0x0246, 0x024e, 2, 1 },
+	{ 0x0345, 0x0345, 1, 0x03b9 - 0x0345 },	/* iota subscript */
+	{ 0x0370, 0x0372, 2, 1 },		/* Greek */
+	{ 0x0376, 0x0376, 1, 1 },
+	{ 0x037f, 0x037f, 1, 0x03f3 - 0x037f },
+	{ 0x0386, 0x0386, 1, 38 },
+	{ 0x0388, 0x038a, 1, 37 },
+	{ 0x038c, 0x038c, 1, 64 },
+	{ 0x038e, 0x038f, 1, 63 },
+	{ 0x0391, 0x03a1, 1, 32 },
+	{ 0x03a3, 0x03ab, 1, 32 },
+	{ 0x03c2, 0x03c2, 1, 1 },		/* final sigma */
+	{ 0x03cf, 0x03cf, 1, 0x03d7 - 0x03cf },
+	{ 0x03d0, 0x03d0, 1, 0x03b2 - 0x03d0 },
+	{ 0x03d1, 0x03d1, 1, 0x03b8 - 0x03d1 },
+	{ 0x03d5, 0x03d5, 1, 0x03c6 - 0x03d5 },
+	{ 0x03d6, 0x03d6, 1, 0x03c0 - 0x03d6 },
+	{ 0x03d8, 0x03ee, 2, 1 },
+	{ 0x03f0, 0x03f0, 1, 0x03ba - 0x03f0 },
+	{ 0x03f1, 0x03f1, 1, 0x03c1 - 0x03f1 },
+	{ 0x03f4, 0x03f4, 1, 0x03b8 - 0x03f4 },
+	{ 0x03f5, 0x03f5, 1, 0x03b5 - 0x03f5 },
+	{ 0x03f7, 0x03f7, 1, 1 },
+	{ 0x03f9, 0x03f9, 1, 0x03f2 - 0x03f9 },
+	{ 0x03fa, 0x03fa, 1, 1 },
+	{ 0x03fd, 0x03ff, 1, -130 },
+	{ 0x0400, 0x040f, 1, 80 },		/* Cyrillic */
+	{ 0x0410, 0x042f, 1, 32 },
+	{ 0x0460, 0x0480, 2, 1 },
+	{ 0x048a, 0x04be, 2, 1 },
+	{ 0x04c0, 0x04c0, 1, 0x04cf - 0x04c0 },
+	{ 0x04c1, 0x04cd, 2, 1 },
+	{ 0x04d0, 0x052e, 2, 1 },
+	{ 0x0531, 0x0556, 1, 48 },		/* Armenian */
+	{ 0x1c80, 0x1c80, 1, 0x0432 - 0x1c80 },	/* Cyrillic Extended-C */
+	{ 0x1c81, 0x1c81, 1, 0x0434 - 0x1c81 },
+	{ 0x1c82, 0x1c82, 1, 0x043e - 0x1c82 },
+	{ 0x1c83, 0x1c84, 1, -6210 },
+	{ 0x1c85, 0x1c85, 1, 0x0442 - 0x1c85 },
+	{ 0x1c86, 0x1c86, 1, 0x044a - 0x1c86 },
+	{ 0x1c87, 0x1c87, 1, 0x0463 - 0x1c87 },
+	{ 0x1c88, 0x1c88, 1, 0xa64b - 0x1c88 },
+	{ 0x1e00, 0x1e94, 2, 1 },		/* Latin Extended Additional */
+	{ 0x1e9b, 0x1e9b, 1, 0x1e61 - 0x1e9b },	/* dotted long s */
+	{ 0x1e9e, 0x1e9e, 1, 0x00df - 0x1e9e },	/* capital sharp s */
+	{ 0x1ea0, 0x1efe, 2, 1 },
+	{ 0x1f08, 0x1f0f, 1, -8 },		/* Greek Extended */
+	{ 0x1f18, 0x1f1d, 1, -8 },
+	{ 0x1f28, 0x1f2f, 1, -8 },
+	{ 0x1f38, 0x1f3f, 1, -8 },
+	{ 0x1f48, 0x1f4d, 1, -8 },
+	{ 0x1f59, 0x1f5f, 2, -8 },
+	{ 0x1f68, 0x1f6f, 1, -8 },
+	{ 0x1f88, 0x1f8f, 1, -8 },
+	{ 0x1f98, 0x1f9f, 1, -8 },
+	{ 0x1fa8, 0x1faf, 1, -8 },
+	{ 0x1fb8, 0x1fb9, 1, -8 },
+	{ 0x1fba, 0x1fbb, 1, -74 },
+	{ 0x1fbc, 0x1fbc, 1, 0x1fb3 - 0x1fbc },
+	{ 0x1fbe, 0x1fbe, 1, 0x03b9 - 0x1fbe },
+	{ 0x1fc8, 0x1fcb, 1, -86 },
+	{ 0x1fcc, 0x1fcc, 1, 0x1fc3 - 0x1fcc },
+	{ 0x1fd8, 0x1fd9, 1, -8 },
+	{ 0x1fda, 0x1fdb, 1, -100 },
+	{ 0x1fe8, 0x1fe9, 1, -8 },
+	{ 0x1fea, 0x1feb, 1, -112 },
+	{ 0x1fec, 0x1fec, 1, 0x1fe5 - 0x1fec },
+	{ 0x1ff8, 0x1ff9, 1, -128 },
+	{ 0x1ffa, 0x1ffb, 1, -126 },
+	{ 0x1ffc, 0x1ffc, 1, 0x1ff3 - 0x1ffc },
+	{ 0x2126, 0x2126, 1, 0x03c9 - 0x2126 },	/* Ohm sign */
+	{ 0x212a, 0x212a, 1, 'k' - 0x212a },	/* Kelvin sign */
+	{ 0x212b, 0x212b, 1, 0x00e5 - 0x212b },	/* Angstrom sign */
+	{ 0x2132, 0x2132, 1, 0x214e - 0x2132 },	/* turned F */
+	{ 0x2160, 0x216f, 1, 16 },		/* Roman numerals */
+	{ 0x2183, 0x2183, 1, 1 },		/* reversed C */
+	{ 0x2c60, 0x2c60, 1, 1 },		/* Latin Extended-C */
+	{ 0x2c62, 0x2c62, 1, 0x026b - 0x2c62 },
+	{ 0x2c63, 0x2c63, 1, 0x1d7d - 0x2c63 },
+	{ 0x2c64, 0x2c64, 1, 0x027d - 0x2c64 },
+	{ 0x2c67, 0x2c6b, 2, 1 },
+	{ 0x2c6d, 0x2c6d, 1, 0x0251 - 0x2c6d },
+	{ 0x2c6e, 0x2c6e, 1, 0x0271 - 0x2c6e },
+	{ 0x2c6f, 0x2c6f, 1, 0x0250 - 0x2c6f },
+	{ 0x2c70, 0x2c70, 1, 0x0252 - 0x2c70 },
+	{ 0x2c72, 0x2c72, 1, 1 },
+	{ 0x2c75, 0x2c75, 1, 1 },
+	{ 0x2c7e, 0x2c7f, 1, -10815 },
+	{ 0xa640, 0xa66c, 2, 1 },		/* Cyrillic Extended-B */
+	{ 0xa680, 0xa69a, 2, 1 },
+	{ 0xa722, 0xa72e, 2, 1 },		/* Latin Extended-D */
+	{ 0xa732, 0xa76e, 2, 1 },
+	{ 0xa779, 0xa77b, 2, 1 },
+	{ 0xa77d, 0xa77d, 1, 0x1d79 - 0xa77d },
+	{ 0xa77e, 0xa786, 2, 1 },
+	{ 0xa78b, 0xa78b, 1, 1 },
+	{ 0xa78d, 0xa78d, 1, 0x0265 - 0xa78d },
+	{ 0xa790, 0xa792, 2, 1 },
+	{ 0xa796, 0xa7a8, 2, 1 },
+	{ 0xa7aa, 0xa7aa, 1, 0x0266 - 0xa7aa },
+	{ 0xa7ab, 0xa7ab, 1, 0x025c - 0xa7ab },
+	{ 0xa7ac, 0xa7ac, 1, 0x0261 - 0xa7ac },
+	{ 0xa7ad, 0xa7ad, 1, 0x026c - 0xa7ad },
+	{ 0xa7ae, 0xa7ae, 1, 0x026a - 0xa7ae },
+	{ 0xa7b0, 0xa7b0, 1, 0x029e - 0xa7b0 },
+	{ 0xa7b1, 0xa7b1, 1, 0x0287 - 0xa7b1 },
+	{ 0xa7b2, 0xa7b2, 1, 0x029d - 0xa7b2 },
+	{ 0xa7b3, 0xa7b3, 1, 0xab53 - 0xa7b3 },
+	{ 0xa7b4, 0xa7c2, 2, 1 },
+	{ 0xa7c4, 0xa7c4, 1, 0xa794 - 0xa7c4 },
+	{ 0xa7c5, 0xa7c5, 1, 0x0282 - 0xa7c5 },
+	{ 0xa7c6, 0xa7c6, 1, 0x1d8e - 0xa7c6 },
+	{ 0xa7c7, 0xa7c9, 2, 1 },
+	{ 0xa7d0, 0xa7d0, 1, 1 },
+	{ 0xa7d6, 0xa7d8, 2, 1 },
+	{ 0xa7f5, 0xa7f5, 1, 1 },
+	{ 0xff21, 0xff3a, 1, 32 },		/* fullwidth Latin */
+};
+
+/**
+ * Folds the case of a code point.
+ *
+ * This is Unicode simple case folding for the Latin, Greek, Cyrillic
+ * and Armenian scripts and the fullwidth Latin letters. Other code
+ * points are returned unchanged.
+ *
+ * @param u  a sanitized code point
+ *
+ * @returns the folded code point
+ */
+static ucode
+fold_case(ucode u)
+{
+	size_t lo = 0, hi = sizeof fold_ranges / sizeof fold_ranges[0];
+
+	if (u < 0x80)
+		return ascii_fold[u];
+	/* Find the last range that starts at or before u */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (fold_ranges[mid].first <= u)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo) {
+		const struct fold_range *r = &fold_ranges[lo - 1];
+		if (u <= r->last && (u - r->first) % r->step == 0)
+			return u + r->offset;
+	}
+	return u;
+}
+
+/**
+ * Tests if a JSON key equals a UTF-8 string, ignoring case.
+ *
+ * Runs of ASCII are compared a byte at a time through a table;
+ * other characters are decoded and compared by #fold_case().
+ *
+ * @param json    JSON key, a quoted string or word (no whitespace)
+ * @param key     a UTF-8 string, which need not be NUL-terminated
+ * @param keylen  the length of @a key
+ *
+ * @retval nonzero The key is equal to @a key under case folding.
+ * @retval 0       The key differs, or is malformed.
+ */
+int
+key_caseeq(const __JSON char *json, const char *key, size_t keylen)
+{
+	const char *key_end = key + keylen;
+	char quote = 0;
+
+	if (!json)
+		return 0;
+	if (*json == '"' || *json == '\'')
+		quote = *json++;
+	else if (!is_word_start(*json))
+		return 0;
+
+	while (key < key_end) {
+		unsigned char jch = *json;
+		unsigned char kch = *key;
+		__SANITIZED ucode ju;
+		ucode ku;
+		size_t n;
+
+		if (quote ? (!jch || jch == quote) : !is_word_char(jch))
+			return 0; /* json key is short */
+		if (jch < 0x80 && kch < 0x80 && jch != '\\') {
+			/* The fast path, for ASCII */
+			if (ascii_fold[jch] != ascii_fold[kch])
+				return 0;
+			json++;
+			key++;
+			continue;
+		}
+		ju = quote ? get_escaped_sanitized(&json)
+			   : get_utf8_sanitized(&json);
+		n = get_utf8_raw_bounded(key, key_end, &ku);
+		if (!n)
+			return 0;
+		key += n;
+		if (fold_case(ju) != fold_case(ku))
+			return 0;
+	}
+	return quote ? *json == quote : !is_word_char(*json);
+}
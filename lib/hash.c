@@ -0,0 +1,78 @@
+#include <stdint.h>
+
+#include "private.h"
+#include "utf8.h"
+
+#define FNV_OFFSET	0xcbf29ce484222325ULL
+#define FNV_PRIME	0x100000001b3ULL
+
+/** Mixes the bits of an FNV-1a hash so that all bits are usable. */
+static uint64_t
+hash_final(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/**
+ * Hashes a UTF-8 key.
+ *
+ * @param key     the key bytes
+ * @param keylen  the length of the key
+ *
+ * @returns a hash of the key
+ */
+uint64_t
+hash_bytes(const void *key, size_t keylen)
+{
+	const unsigned char *p = key;
+	uint64_t h = FNV_OFFSET;
+
+	while (keylen--)
+		h = (h ^ *p++) * FNV_PRIME;
+	return hash_final(h);
+}
+
+/**
+ * Hashes the content of a JSON string or word.
+ *
+ * The result is the same as #hash_bytes() of the C string that
+ * #json_strcmp() would find equal to the JSON text, so that
+ * escaped and unescaped forms of a key hash alike.
+ *
+ * @param json  JSON string or word (not whitespace)
+ *
+ * @returns a hash of the decoded key
+ */
+uint64_t
+hash_json_key(const __JSON char *json)
+{
+	uint64_t h = FNV_OFFSET;
+	char quote;
+
+	if (*json != '"' && *json != '\'') {
+		while (is_word_char(*json))
+			h = (h ^ (unsigned char)*json++) * FNV_PRIME;
+		return hash_final(h);
+	}
+
+	quote = *json++;
+	while (*json && *json != quote) {
+		unsigned char buf[4];
+		size_t i, n;
+
+		if (*json > 0 && *json != '\\') {
+			h = (h ^ (unsigned char)*json++) * FNV_PRIME;
+			continue;
+		}
+		/* Escapes and non-ASCII are hashed as they compare */
+		n = put_utf8_raw(get_escaped_sanitized(&json), buf, sizeof buf);
+		for (i = 0; i < n; i++)
+			h = (h ^ buf[i]) * FNV_PRIME;
+	}
+	return hash_final(h);
+}
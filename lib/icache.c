@@ -0,0 +1,391 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "private.h"
+
+#ifdef __linux__
+# include <unistd.h>
+# include <sys/syscall.h>
+# include <linux/random.h>
+#endif
+
+#define WHITESPACE	" \t\n\r"
+
+#define CACHE_WAYS	8		/* slots per set */
+#define CACHE_SETS	128		/* a power of 2 */
+#define CACHE_SLOTS	(CACHE_SETS * CACHE_WAYS)
+
+/*
+ * Each slot's word packs its state, so that a reader can take a
+ * reference with one compare-and-swap that also proves the slot
+ * has not been refilled since it was looked at:
+ *
+ *     bits 63..32  sequence, changed whenever the slot is refilled
+ *     bit  31      the slot holds an entry
+ *     bits 30..0   references held by callers
+ */
+#define SLOT_VALID	0x80000000u
+#define SLOT_REFS	0x7fffffffu
+#define SLOT_SEQ	((uint64_t)1 << 32)
+
+/* A cached image, which follows its entry in the same allocation */
+struct entry {
+	uint64_t hash;		/* content hash of the text */
+	size_t len;		/* length of the text */
+	size_t size;		/* bytes charged to the budget */
+	const __JSON char *text; /* the text within the image */
+	struct slot *slot;	/* NULL if the image is not cached */
+};
+
+struct slot {
+	uint64_t word;		/* state, see SLOT_VALID */
+	uint64_t hash;		/* the entry's hash, readable without it */
+	struct entry *entry;
+	unsigned char referenced; /* used since the clock hand passed */
+};
+
+struct json_image_cache {
+	struct slot slots[CACHE_SLOTS];
+	size_t budget;
+	size_t used;		/* bytes of cached entries */
+	size_t hand;		/* the clock hand, a slot index */
+	uint64_t seed;		/* of content_hash(), chosen at random */
+	char lock;		/* held while slots are filled or emptied */
+};
+
+static void
+lock(struct json_image_cache *c)
+{
+	while (__atomic_test_and_set(&c->lock, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(&c->lock, __ATOMIC_RELAXED))
+			;
+}
+
+static void
+unlock(struct json_image_cache *c)
+{
+	__atomic_clear(&c->lock, __ATOMIC_RELEASE);
+}
+
+static uint64_t
+rotl(uint64_t x, int n)
+{
+	return (x << n) | (x >> (64 - n));
+}
+
+/**
+ * Hashes a document's text.
+ *
+ * Documents can be large, so this consumes 16 bytes per step in two
+ * independent lanes, rather than a byte at a time like #hash_bytes().
+ * Each cache has its own seed, so that callers cannot choose documents
+ * that all fall in one set and evict each other.
+ */
+static uint64_t
+content_hash(const char *p, size_t len, uint64_t seed)
+{
+	const uint64_t k1 = 0x9e3779b97f4a7c15ULL;
+	const uint64_t k2 = 0xc2b2ae3d27d4eb4fULL;
+	uint64_t a = (len ^ seed) * k1, b = ~len ^ rotl(seed, 32);
+	uint64_t x, y;
+
+	for (; len >= 16; p += 16, len -= 16) {
+		memcpy(&x, p, 8);
+		memcpy(&y, p + 8, 8);
+		a = rotl(a ^ x, 29) * k1;
+		b = rotl(b ^ y, 31) * k2;
+	}
+	x = y = 0;
+	memcpy(&x, p, len < 8 ? len : 8);
+	if (len > 8)
+		memcpy(&y, p + 8, len - 8);
+	a = rotl(a ^ x, 29) * k1;
+	b = rotl(b ^ y, 31) * k2;
+	a ^= rotl(b, 17);
+	a ^= a >> 33;
+	a *= k2;
+	a ^= a >> 29;
+	return a;
+}
+
+/** Chooses a random seed for a new cache's hash */
+static uint64_t
+new_seed(const struct json_image_cache *c)
+{
+	static uint64_t counter;
+	uint64_t mix[3];
+
+#if defined(__linux__) && defined(SYS_getrandom)
+	int save_errno = errno;
+	long n = syscall(SYS_getrandom, &mix[0], sizeof mix[0],
+	    GRND_NONBLOCK);
+
+	errno = save_errno;
+	if (n == sizeof mix[0])
+		return mix[0];
+#endif
+	/* Otherwise, mix what differs between caches and runs */
+	mix[0] = (uintptr_t)c;
+	mix[1] = (uint64_t)time(NULL) ^ (uint64_t)clock() << 32;
+	mix[2] = __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED);
+	return content_hash((const char *)mix, sizeof mix, 0);
+}
+
+/**
+ * Takes a reference to a slot's entry if it holds the document.
+ *
+ * @returns the entry, with a reference held
+ * @retval NULL The slot holds some other document, or none.
+ */
+static struct entry *
+slot_get(struct slot *s, uint64_t hash, const __JSON char *json, size_t len)
+{
+	uint64_t w = __atomic_load_n(&s->word, __ATOMIC_ACQUIRE);
+	struct entry *e;
+
+	do {
+		if (!(w & SLOT_VALID) || (w & SLOT_REFS) == SLOT_REFS ||
+		    __atomic_load_n(&s->hash, __ATOMIC_RELAXED) != hash)
+			return NULL;
+		e = __atomic_load_n(&s->entry, __ATOMIC_RELAXED);
+		/* This fails if the slot changed since w was loaded */
+	} while (!__atomic_compare_exchange_n(&s->word, &w, w + 1, 0,
+	    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+	if (e->len == len && memcmp(e->text, json, len) == 0) {
+		__atomic_store_n(&s->referenced, 1, __ATOMIC_RELAXED);
+		return e;
+	}
+	__atomic_fetch_sub(&s->word, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/** Looks up a document in its set, without locking */
+static struct entry *
+lookup(struct json_image_cache *c, uint64_t hash, const __JSON char *json,
+	size_t len)
+{
+	struct slot *set = &c->slots[(hash & (CACHE_SETS - 1)) * CACHE_WAYS];
+	size_t i;
+
+	for (i = 0; i < CACHE_WAYS; i++) {
+		struct entry *e = slot_get(&set[i], hash, json, len);
+		if (e)
+			return e;
+	}
+	return NULL;
+}
+
+/**
+ * Empties a slot whose entry is not referenced. Called locked.
+ *
+ * @retval 1 The slot is now empty.
+ * @retval 0 The slot's entry is in use.
+ */
+static int
+evict(struct json_image_cache *c, struct slot *s)
+{
+	uint64_t w = __atomic_load_n(&s->word, __ATOMIC_ACQUIRE);
+	struct entry *e;
+
+	if (!(w & SLOT_VALID))
+		return 1;
+	if (w & SLOT_REFS)
+		return 0;
+	/* Only readers change a filled slot's word, and only by taking a
+	 * reference, so a failed swap means the entry is in use */
+	if (!__atomic_compare_exchange_n(&s->word, &w,
+	    (w & ~(SLOT_SEQ - 1)) + SLOT_SEQ, 0,
+	    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		return 0;
+	e = s->entry;
+	__atomic_fetch_sub(&c->used, e->size, __ATOMIC_RELAXED);
+	free(e);
+	return 1;
+}
+
+/**
+ * Evicts entries until @a size more bytes fit in the budget,
+ * by the CLOCK algorithm. Called locked.
+ *
+ * Each unreferenced slot that the hand passes loses its referenced
+ * mark, and is evicted if it had none. Two turns of the hand visit
+ * every slot with its mark cleared, so after that the rest are in use.
+ *
+ * @retval 0 The entry fits.
+ * @retval -1 Too many entries are in use.
+ */
+static int
+make_room(struct json_image_cache *c, size_t size)
+{
+	size_t steps;
+
+	for (steps = 0; c->used + size > c->budget; steps++) {
+		struct slot *s = &c->slots[c->hand];
+
+		if (steps == 2 * CACHE_SLOTS)
+			return -1;
+		c->hand = (c->hand + 1) % CACHE_SLOTS;
+		if (__atomic_load_n(&s->referenced, __ATOMIC_RELAXED))
+			__atomic_store_n(&s->referenced, 0, __ATOMIC_RELAXED);
+		else
+			(void) evict(c, s);
+	}
+	return 0;
+}
+
+/**
+ * Finds an empty slot in a set, evicting an unreferenced entry
+ * if needed. Called locked.
+ *
+ * @returns the empty slot
+ * @retval NULL Every entry in the set is in use.
+ */
+static struct slot *
+free_slot(struct json_image_cache *c, uint64_t hash)
+{
+	struct slot *set = &c->slots[(hash & (CACHE_SETS - 1)) * CACHE_WAYS];
+	size_t i;
+
+	for (i = 0; i < CACHE_WAYS; i++)
+		if (!(__atomic_load_n(&set[i].word, __ATOMIC_ACQUIRE) &
+		    SLOT_VALID))
+			return &set[i];
+	for (i = 0; i < CACHE_WAYS; i++)
+		if (!__atomic_load_n(&set[i].referenced, __ATOMIC_RELAXED) &&
+		    evict(c, &set[i]))
+			return &set[i];
+	for (i = 0; i < CACHE_WAYS; i++)
+		if (evict(c, &set[i]))
+			return &set[i];
+	return NULL;
+}
+
+/** Builds a new, uncached entry for a document */
+static struct entry *
+build(const __JSON char *json, uint64_t hash)
+{
+	struct entry *e;
+	size_t size;
+
+	e = image_alloc(json, 1, sizeof *e, &size);
+	if (!e)
+		return NULL;
+	e->hash = hash;
+	e->size = sizeof *e + size;
+	e->text = image_text(e + 1);
+	/* The text may end in whitespace, which the key leaves out */
+	e->len = strlen(e->text);
+	while (e->len && strchr(WHITESPACE, e->text[e->len - 1]))
+		e->len--;
+	e->slot = NULL;
+	return e;
+}
+
+__PUBLIC
+struct json_image_cache *
+json_image_cache_new(size_t budget)
+{
+	struct json_image_cache *c = calloc(1, sizeof *c);
+
+	if (!c)
+		return NULL;
+	c->budget = budget;
+	c->seed = new_seed(c);
+	return c;
+}
+
+__PUBLIC
+void
+json_image_cache_free(struct json_image_cache *c)
+{
+	size_t i;
+
+	if (!c)
+		return;
+	for (i = 0; i < CACHE_SLOTS; i++)
+		if (c->slots[i].word & SLOT_VALID)
+			free(c->slots[i].entry);
+	free(c);
+}
+
+__PUBLIC
+const void *
+json_image_cache_get(struct json_image_cache *c, const __JSON char *json)
+{
+	struct entry *e, *found;
+	struct slot *s;
+	uint64_t hash;
+	size_t len;
+
+	if (!json) {
+		errno = EINVAL;
+		return NULL;
+	}
+	/* The key is the text less any trailing whitespace, which is
+	 * much quicker to find than the span of the value */
+	len = strlen(json);
+	while (len && strchr(WHITESPACE, json[len - 1]))
+		len--;
+	hash = content_hash(json, len, c->seed);
+	e = lookup(c, hash, json, len);
+	if (e)
+		return e + 1;
+
+	/* Build outside the lock; another thread may build it too */
+	e = build(json, hash);
+	if (!e)
+		return NULL;
+	if (e->len != len)
+		return e + 1;	/* text follows the value; it has no key */
+	lock(c);
+	found = lookup(c, hash, json, len);
+	if (found) {
+		unlock(c);
+		free(e);
+		return found + 1;
+	}
+	/* Entries that do not fit are returned uncached */
+	if (e->size <= c->budget && make_room(c, e->size) == 0 &&
+	    (s = free_slot(c, hash)) != NULL)
+	{
+		uint64_t w = __atomic_load_n(&s->word, __ATOMIC_RELAXED);
+
+		__atomic_store_n(&s->hash, hash, __ATOMIC_RELAXED);
+		__atomic_store_n(&s->entry, e, __ATOMIC_RELAXED);
+		__atomic_store_n(&s->referenced, 1, __ATOMIC_RELAXED);
+		e->slot = s;
+		__atomic_fetch_add(&c->used, e->size, __ATOMIC_RELAXED);
+		/* Publish the entry with the caller's reference */
+		__atomic_store_n(&s->word, (w & ~(SLOT_SEQ - 1)) + SLOT_SEQ +
+		    SLOT_VALID + 1, __ATOMIC_RELEASE);
+	}
+	unlock(c);
+	return e + 1;
+}
+
+__PUBLIC
+void
+json_image_cache_release(struct json_image_cache *c, const void *image)
+{
+	struct entry *e;
+
+	(void) c;
+	if (!image)
+		return;
+	e = (struct entry *)image - 1;
+	if (e->slot)
+		__atomic_fetch_sub(&e->slot->word, 1, __ATOMIC_RELEASE);
+	else
+		free(e);
+}
+
+__PUBLIC
+size_t
+json_image_cache_size(const struct json_image_cache *c)
+{
+	return __atomic_load_n(&c->used, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,562 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "private.h"
+
+#define IMAGE_MAGIC	0x4d494a52	/* "RJIM" */
+#define IMAGE_VERSION	1
+
+/*
+ * An image is a single block that holds a document's text and an index
+ * of every object and array in it. Everything in it is addressed by
+ * offsets, so that it can be used wherever it is mapped.
+ *
+ *     struct image_header
+ *     struct image_container[ncontainers]   sorted by offset in the text
+ *     uint32_t tables[]                     the members of each container
+ *     char text[textlen + 1]                the document, NUL-terminated
+ *
+ * An object's table holds the key and value offsets of its members,
+ * sorted as by #json_object_sorted_index(). An array's table holds the
+ * offsets of its elements in order. Table offsets are relative to the
+ * image; key and value offsets are relative to the text.
+ */
+struct image_header {
+	uint32_t magic;		/* IMAGE_MAGIC */
+	uint32_t version;	/* IMAGE_VERSION */
+	uint64_t generation;	/* the caller's generation, stored last */
+	uint32_t size;		/* size of the whole image */
+	uint32_t text;		/* offset of the text */
+	uint32_t textlen;	/* length of the text */
+	uint32_t containers;	/* offset of the container array */
+	uint32_t ncontainers;	/* number of containers */
+	uint32_t reserved;
+};
+
+struct image_container {
+	uint32_t at;		/* offset of the '{' or '[' in the text */
+	uint32_t count;		/* number of members or elements */
+	uint32_t table;		/* offset of the table in the image */
+	uint32_t kind;		/* JSON_OBJECT or JSON_ARRAY */
+};
+
+/** Stores the generation so that it is seen after the rest of the image */
+static void
+store_generation(struct image_header *h, uint64_t generation)
+{
+#ifdef __GNUC__
+	__atomic_store_n(&h->generation, generation, __ATOMIC_RELEASE);
+#else
+	*(volatile uint64_t *)&h->generation = generation;
+#endif
+}
+
+/** Loads the generation, ordering later reads of the image after it */
+static uint64_t
+load_generation(const struct image_header *h)
+{
+#ifdef __GNUC__
+	return __atomic_load_n(&h->generation, __ATOMIC_ACQUIRE);
+#else
+	return *(const volatile uint64_t *)&h->generation;
+#endif
+}
+
+/* A container whose members are being collected */
+struct frame {
+	size_t c;		/* index of the container */
+	const __JSON char *ji;	/* the iterator over its members */
+	size_t first;		/* index of its first word in the members */
+};
+
+/** Storage for an image while it is being built */
+struct builder {
+	struct image_container *c;	/* in order of their offsets */
+	size_t nc, c_alloc;
+	uint32_t *w;		/* the tables */
+	size_t nw, w_alloc;
+	uint32_t *m;		/* the members of the open containers */
+	size_t nm, m_alloc;
+	struct frame *f;	/* the open containers, innermost last */
+	size_t nf, f_alloc;
+};
+
+/** Ensures an array that doubles as it grows has room for n more */
+static int
+reserve(void **array, size_t *alloc, size_t used, size_t n, size_t size)
+{
+	size_t want = *alloc ? *alloc : 16;
+	void *a;
+
+	if (used + n <= *alloc)
+		return 0;
+	while (want < used + n)
+		want *= 2;
+	a = realloc(*array, want * size);
+	if (!a)
+		return -1;
+	*array = a;
+	*alloc = want;
+	return 0;
+}
+
+/** Appends an offset to the members of the innermost container */
+static int
+add_member(struct builder *b, uint32_t word)
+{
+	void *m = b->m;
+	int ret = reserve(&m, &b->m_alloc, b->nm, 1, sizeof *b->m);
+
+	b->m = m;
+	if (ret == -1)
+		return -1;
+	b->m[b->nm++] = word;
+	return 0;
+}
+
+/**
+ * Starts collecting the members of a value, if it is a container.
+ * Containers are opened in the order they appear in the text, so the
+ * container array stays sorted by offset.
+ */
+static int
+open_container(struct builder *b, const __JSON char *text,
+	const __JSON char *value)
+{
+	enum json_type type = json_type(value);
+	void *c, *f;
+	int ret;
+
+	if (type != JSON_OBJECT && type != JSON_ARRAY)
+		return 0;
+	c = b->c;
+	ret = reserve(&c, &b->c_alloc, b->nc, 1, sizeof *b->c);
+	b->c = c;
+	if (ret == -1)
+		return -1;
+	f = b->f;
+	ret = reserve(&f, &b->f_alloc, b->nf, 1, sizeof *b->f);
+	b->f = f;
+	if (ret == -1)
+		return -1;
+	b->c[b->nc].at = value - text;
+	b->c[b->nc].count = 0;
+	b->c[b->nc].table = 0;
+	b->c[b->nc].kind = type;
+	b->f[b->nf].c = b->nc;
+	b->f[b->nf].ji = type == JSON_OBJECT ? json_as_object(value) :
+	    json_as_array(value);
+	b->f[b->nf].first = b->nm;
+	b->nc++;
+	b->nf++;
+	return 0;
+}
+
+/** Moves the innermost container's members into its table */
+static int
+close_container(struct builder *b, const __JSON char *text)
+{
+	struct frame *f = &b->f[b->nf - 1];
+	struct image_container *c = &b->c[f->c];
+	size_t n = b->nm - f->first;
+	void *w = b->w;
+	int ret = reserve(&w, &b->w_alloc, b->nw, n, sizeof *b->w);
+
+	b->w = w;
+	if (ret == -1)
+		return -1;
+	if (n)
+		memcpy(b->w + b->nw, b->m + f->first, n * sizeof *b->w);
+	c->table = b->nw;
+	if (c->kind == JSON_OBJECT) {
+		c->count = n / 2;
+		sort_members(text, b->w + b->nw, c->count);
+	} else
+		c->count = n;
+	b->nw += n;
+	b->nm = f->first;
+	b->nf--;
+	return 0;
+}
+
+/**
+ * Collects the members of every container in the text.
+ *
+ * This steps through the members as #json_object_next() and
+ * #json_array_next() do, but descends into each container value
+ * instead of skipping it, so that every byte is scanned once.
+ * The open containers are kept on an explicit stack, so nothing
+ * recurses, however deep the text. Each container's table is
+ * recorded as an offset into @c b->w for now.
+ *
+ * Text that the member iterators would stop at, such as a missing
+ * member in @c [1,,2], fails the build rather than being indexed.
+ *
+ * @retval 0 Success.
+ * @retval -1 [ENOMEM] Allocation failed, or the text is too deeply
+ *                     nested.
+ * @retval -1 [EINVAL] A container's members are malformed.
+ */
+static int
+collect(struct builder *b, const __JSON char *text, const __JSON char *root)
+{
+	errno = 0;
+	if (open_container(b, text, root) == -1)
+		return -1;
+	while (b->nf) {
+		struct frame *f = &b->f[b->nf - 1];
+		int object = b->c[f->c].kind == JSON_OBJECT;
+		const __JSON char *ji = f->ji;
+		const __JSON char *value;
+		size_t nf = b->nf;
+		int advanced = 0;
+
+		if (*ji == (object ? '}' : ']')) {
+			/* The container ends; resume its parent after it */
+			if (close_container(b, text) == -1)
+				return -1;
+			if (!b->nf)
+				break;
+			f = &b->f[b->nf - 1];
+			ji++;
+			skip_white(&ji);
+			can_skip_char(&ji, ',');
+			f->ji = ji;
+			continue;
+		}
+		if (object) {
+			if (add_member(b, ji - text) == -1)
+				return -1;
+			advanced |= skip_value(&ji);
+			advanced |= can_skip_char(&ji, ':');
+			if (errno)
+				return -1;
+		}
+		value = ji;
+		if (add_member(b, value - text) == -1 ||
+		    open_container(b, text, value) == -1)
+			return -1;
+		f = &b->f[nf - 1];	/* the stack may have moved */
+		if (b->nf > nf) {
+			/* Descend; the parent resumes when it closes */
+			f->ji = value;
+			continue;
+		}
+		advanced |= skip_value(&ji);
+		advanced |= can_skip_char(&ji, ',');
+		if (errno)
+			return -1;
+		if (!advanced) {
+			errno = EINVAL;
+			return -1;
+		}
+		f->ji = ji;
+	}
+	return 0;
+}
+
+/** Frees a builder's storage */
+static void
+builder_free(struct builder *b)
+{
+	free(b->c);
+	free(b->w);
+	free(b->m);
+	free(b->f);
+}
+
+/**
+ * Checks a document and collects its containers.
+ *
+ * @param b            the builder, which is initialised
+ * @param textlen_ret  where to store the length of the text
+ *
+ * @returns the size of the image
+ * @retval 0 [EINVAL] The text is malformed.
+ * @retval 0 [ENOMEM] Allocation failed.
+ * @retval 0 [EOVERFLOW] The image would be 4 GiB or larger.
+ */
+static size_t
+prepare(struct builder *b, const __JSON char *json, size_t *textlen_ret)
+{
+	const __JSON char *root;
+	size_t textlen, size;
+
+	memset(b, 0, sizeof *b);
+	/* Check the whole document first, so that errors in it are
+	 * reported as json_span() reports them */
+	errno = 0;
+	textlen = json_span(json);
+	if (!textlen) {
+		if (!errno)
+			errno = EINVAL;
+		return 0;
+	}
+	if (textlen >= UINT32_MAX) {
+		errno = EOVERFLOW;
+		return 0;
+	}
+	root = json;
+	skip_white(&root);
+	if (collect(b, json, root) == -1)
+		return 0;
+	size = sizeof (struct image_header) + b->nc * sizeof *b->c +
+	    b->nw * sizeof *b->w + textlen + 1;
+	if (size > UINT32_MAX) {
+		errno = EOVERFLOW;
+		return 0;
+	}
+	*textlen_ret = textlen;
+	return size;
+}
+
+/** Writes the image that #prepare() collected, and publishes it */
+static void
+fill(struct builder *b, const __JSON char *json, size_t textlen,
+	size_t size, uint64_t generation, void *dst)
+{
+	struct image_header *h = dst;
+	char *image = dst;
+	size_t i;
+
+	/* Readers must not take a half-built image for a published one */
+	store_generation(h, 0);
+	h->magic = IMAGE_MAGIC;
+	h->version = IMAGE_VERSION;
+	h->containers = sizeof *h;
+	h->ncontainers = b->nc;
+	h->text = size - textlen - 1;
+	h->textlen = textlen;
+	h->size = size;
+	h->reserved = 0;
+	for (i = 0; i < b->nc; i++)
+		b->c[i].table = sizeof *h + b->nc * sizeof *b->c +
+		    b->c[i].table * sizeof *b->w;
+	if (b->nc)
+		memcpy(image + h->containers, b->c, b->nc * sizeof *b->c);
+	if (b->nw)
+		memcpy(image + h->containers + b->nc * sizeof *b->c, b->w,
+		    b->nw * sizeof *b->w);
+	memcpy(image + h->text, json, textlen);
+	image[h->text + textlen] = '\0';
+	store_generation(h, generation);
+}
+
+__PUBLIC
+size_t
+json_image_build(const __JSON char *json, uint64_t generation,
+	void *dst, size_t dstsz)
+{
+	struct builder b;
+	size_t textlen, size;
+
+	if (!generation || ((uintptr_t)dst & 7)) {
+		errno = EINVAL;
+		return 0;
+	}
+	size = prepare(&b, json, &textlen);
+	if (size && dstsz) {
+		if (dstsz < size) {
+			errno = ENOMEM;
+			size = 0;
+		} else
+			fill(&b, json, textlen, size, generation, dst);
+	}
+	builder_free(&b);
+	return size;
+}
+
+/**
+ * Builds an image into a new allocation of exactly its size.
+ *
+ * Unlike sizing with #json_image_build() and then building, this
+ * scans the text and collects its containers only once.
+ *
+ * @param json        JSON text, smaller than 4 GiB
+ * @param generation  a nonzero version number
+ * @param before      bytes to allocate before the image, a multiple
+ *                    of 8
+ * @param size_ret    where to store the size of the image
+ *
+ * @returns the allocation, to be freed with @c free(); the image
+ *          starts @a before bytes into it
+ * @retval NULL [ENOMEM] Allocation failed.
+ * @retval NULL [EINVAL] The text is malformed, or @a generation is 0.
+ * @retval NULL [EOVERFLOW] The image would be 4 GiB or larger.
+ */
+void *
+image_alloc(const __JSON char *json, uint64_t generation, size_t before,
+	size_t *size_ret)
+{
+	struct builder b;
+	size_t textlen, size;
+	char *p = NULL;
+
+	if (!generation) {
+		errno = EINVAL;
+		return NULL;
+	}
+	size = prepare(&b, json, &textlen);
+	if (size > SIZE_MAX - before)
+		errno = ENOMEM;
+	else if (size) {
+		p = malloc(before + size);
+		if (p) {
+			fill(&b, json, textlen, size, generation, p + before);
+			*size_ret = size;
+		}
+	}
+	builder_free(&b);
+	return p;
+}
+
+__PUBLIC
+void *
+json_image_new(const __JSON char *json, uint64_t generation)
+{
+	size_t size;
+
+	return image_alloc(json, generation, 0, &size);
+}
+
+/** Returns the header of a published image, or NULL with EINVAL */
+static const struct image_header *
+image_header(const void *image)
+{
+	const struct image_header *h = image;
+
+	if (!h || ((uintptr_t)h & 7) || !load_generation(h) ||
+	    h->magic != IMAGE_MAGIC || h->version != IMAGE_VERSION)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+	return h;
+}
+
+__PUBLIC
+uint64_t
+json_image_generation(const void *image)
+{
+	const struct image_header *h = image_header(image);
+
+	return h ? load_generation(h) : 0;
+}
+
+/** Returns the text of an image that #json_image_build() built */
+const __JSON char *
+image_text(const void *image)
+{
+	const struct image_header *h = image;
+
+	return (const char *)image + h->text;
+}
+
+/**
+ * Selects a value by one component of a selection path,
+ * using the image's index instead of scanning the text.
+ *
+ * @returns pointer within the image text to the selected value
+ * @retval NULL [ENOENT] The component was not found in the value.
+ */
+static const __JSON char *
+image_component(const struct image_header *h, const __JSON char *json,
+	const struct path_component *pc)
+{
+	const char *image = (const char *)h;
+	const __JSON char *text = image + h->text;
+	const struct image_container *c;
+	const uint32_t *table;
+	size_t lo = 0, hi = h->ncontainers;
+	uint32_t at;
+
+	skip_white(&json);
+	at = json - text;
+	c = (const struct image_container *)(image + h->containers);
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (c[mid].at < at)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == h->ncontainers || c[lo].at != at)
+		goto enoent;	/* not a container */
+	c += lo;
+	table = (const uint32_t *)(image + c->table);
+
+	if (!pc->key) {
+		if (c->kind != JSON_ARRAY || pc->index >= c->count)
+			goto enoent;
+		return text + table[pc->index];
+	}
+	if (c->kind != JSON_OBJECT)
+		goto enoent;
+	/* Find the first member whose key is not below pc->key */
+	lo = 0;
+	hi = c->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (key_strcmp(text + table[2 * mid], pc->key, pc->keylen,
+		    0) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < c->count &&
+	    key_strcmp(text + table[2 * lo], pc->key, pc->keylen, 0) == 0)
+		return text + table[2 * lo + 1];
+enoent:
+	errno = ENOENT;
+	return NULL;
+}
+
+__PUBLIC
+const __JSON char *
+json_image_selectv(const void *image, const char *path, va_list ap)
+{
+	const struct image_header *h = image_header(image);
+	const __JSON char *json;
+	struct path_component pc;
+	int first = 1;
+	va_list aq;
+
+	if (!h)
+		return NULL;
+	json = (const char *)image + h->text;
+
+	va_copy(aq, ap);
+	while (json && *path) {
+		switch (next_path_component(&path, first, &aq, &pc)) {
+		case 0:
+			goto fail;
+		case -1:
+			errno = ENOENT;
+			goto fail;
+		}
+		json = image_component(h, json, &pc);
+		first = 0;
+	}
+	va_end(aq);
+	if (json)
+		errno = 0;
+	return json;
+fail:
+	va_end(aq);
+	return NULL;
+}
+
+__PUBLIC
+const __JSON char *
+json_image_select(const void *image, const char *path, ...)
+{
+	va_list ap;
+	const char *ret;
+
+	va_start(ap, path);
+	ret = json_image_selectv(image, path, ap);
+	va_end(ap);
+	return ret;
+}
@@ -0,0 +1,330 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "private.h"
+
+#define MIN_SLOTS	64	/* initial hash table size, a power of 2 */
+#define CHUNK0		64	/* ids in the first chunk of names */
+#define NCHUNKS		26	/* chunks double, so this allows 2^31 ids */
+
+/*
+ * Readers never lock. Adding takes a spin lock that only writers
+ * contend for, and publishes each change with a single release store,
+ * in this order:
+ *
+ *  1. the new name is stored in its chunk, whose pointer never changes
+ *     once published, so names never move;
+ *  2. the count of names is incremented;
+ *  3. the name is stored in an empty hash slot.
+ *
+ * So a reader that finds an id by key can always look its name up.
+ *
+ * When the hash table fills, a larger copy is published in its place.
+ * Readers may still be probing the old one, so it is only retired, and
+ * freed with the intern table. The retired tables together are smaller
+ * than the current one.
+ */
+
+/* An interned key */
+struct name {
+	uint64_t hash;		/* from hash_bytes() */
+	size_t len;
+	int id;
+	char key[];		/* NUL-terminated */
+};
+
+/* An open-addressed hash table of names */
+struct table {
+	size_t nslots;		/* a power of 2 */
+	struct table *retired;	/* the table this one replaced */
+	struct name *slots[];	/* NULL when empty */
+};
+
+struct json_intern {
+	struct table *table;
+	struct name **chunks[NCHUNKS];	/* chunk c holds CHUNK0 << c ids */
+	int count;
+	char lock;		/* held while adding */
+};
+
+static void
+lock(struct json_intern *t)
+{
+	while (__atomic_test_and_set(&t->lock, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(&t->lock, __ATOMIC_RELAXED))
+			;
+}
+
+static void
+unlock(struct json_intern *t)
+{
+	__atomic_clear(&t->lock, __ATOMIC_RELEASE);
+}
+
+/** Finds the chunk of names that holds an id, and the id's place in it */
+static size_t
+chunk_of(int id, size_t *i_return)
+{
+	size_t n = (size_t)id / CHUNK0 + 1;
+	size_t c = 0;
+
+	while (n >> (c + 1))
+		c++;
+	*i_return = (size_t)id - CHUNK0 * (((size_t)1 << c) - 1);
+	return c;
+}
+
+/** Allocates a hash table of empty slots. */
+static struct table *
+new_table(size_t nslots)
+{
+	struct table *tab = big_alloc(sizeof *tab +
+	    nslots * sizeof tab->slots[0]);
+
+	if (tab) {
+		tab->nslots = nslots;
+		tab->retired = NULL;
+		memset(tab->slots, 0, nslots * sizeof tab->slots[0]);
+	}
+	return tab;
+}
+
+/** Publishes a hash table of twice the size. Called locked. */
+static int
+grow_table(struct json_intern *t)
+{
+	struct table *old = t->table;
+	size_t nslots = old->nslots * 2;
+	struct table *tab = new_table(nslots);
+	size_t i, j;
+
+	if (!tab)
+		return -1;
+	for (i = 0; i < old->nslots; i++) {
+		struct name *n = old->slots[i];
+		if (!n)
+			continue;
+		for (j = n->hash & (nslots - 1); tab->slots[j];
+		    j = (j + 1) & (nslots - 1))
+			;
+		tab->slots[j] = n;
+	}
+	tab->retired = old;
+	__atomic_store_n(&t->table, tab, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/**
+ * Finds a key's name, or the empty slot where it belongs.
+ *
+ * @param tab   the hash table
+ * @param hash  the key's hash, from #hash_bytes() or #hash_json_key()
+ * @param json  the key as JSON text, or @c NULL
+ * @param key   the key as a C string, when @a json is @c NULL
+ * @param len   the length of @a key
+ * @param slot_return  (optional) storage for the index of the slot
+ *
+ * @returns the key's name
+ * @retval NULL The key is not in the table.
+ */
+static const struct name *
+find_name(const struct table *tab, uint64_t hash, const __JSON char *json,
+	const char *key, size_t len, size_t *slot_return)
+{
+	size_t mask = tab->nslots - 1;
+	const struct name *n;
+	size_t i;
+
+	for (i = hash & mask;
+	    (n = __atomic_load_n(&tab->slots[i], __ATOMIC_ACQUIRE));
+	    i = (i + 1) & mask)
+	{
+		if (n->hash != hash)
+			continue;
+		if (json) {
+			int save_errno = errno;
+			int cmp = json_strcmpn(json, n->key, n->len);
+			errno = save_errno; /* words set EINVAL */
+			if (cmp == 0)
+				break;
+		} else if (n->len == len && memcmp(n->key, key, len) == 0)
+			break;
+	}
+	if (slot_return)
+		*slot_return = i;
+	return n;
+}
+
+/** Returns the current hash table */
+static const struct table *
+current(const struct json_intern *t)
+{
+	return __atomic_load_n(&t->table, __ATOMIC_ACQUIRE);
+}
+
+__PUBLIC
+struct json_intern *
+json_intern_new(void)
+{
+	struct json_intern *t = calloc(1, sizeof *t);
+
+	if (!t)
+		return NULL;
+	t->table = new_table(MIN_SLOTS);
+	if (!t->table) {
+		free(t);
+		return NULL;
+	}
+	return t;
+}
+
+__PUBLIC
+void
+json_intern_free(struct json_intern *t)
+{
+	struct table *tab;
+	size_t c, i;
+	int id;
+
+	if (!t)
+		return;
+	for (id = 0; id < t->count; id++) {
+		c = chunk_of(id, &i);
+		free(t->chunks[c][i]);
+	}
+	for (c = 0; c < NCHUNKS; c++)
+		free(t->chunks[c]);
+	while ((tab = t->table)) {
+		t->table = tab->retired;
+		big_free(tab);
+	}
+	free(t);
+}
+
+__PUBLIC
+int
+json_intern_add(struct json_intern *t, const char *key)
+{
+	size_t len = strlen(key);
+	uint64_t hash = hash_bytes(key, len);
+	const struct name *found;
+	struct name *n;
+	size_t slot, c, i;
+	int id;
+
+	/* Keys that are already present need no lock */
+	found = find_name(current(t), hash, NULL, key, len, NULL);
+	if (found)
+		return found->id;
+
+	lock(t);
+	found = find_name(t->table, hash, NULL, key, len, &slot);
+	if (found) {
+		unlock(t);
+		return found->id;
+	}
+	id = t->count;
+	c = chunk_of(id, &i);
+	if (c == NCHUNKS) {
+		errno = ENOMEM;
+		goto fail;
+	}
+	if (!t->chunks[c]) {
+		struct name **chunk = malloc((CHUNK0 << c) * sizeof *chunk);
+		if (!chunk)
+			goto fail;
+		__atomic_store_n(&t->chunks[c], chunk, __ATOMIC_RELEASE);
+	}
+	/* Keep the load factor at or below 1/2 */
+	if ((size_t)(id + 1) * 2 > t->table->nslots) {
+		if (grow_table(t) == -1)
+			goto fail;
+		(void) find_name(t->table, hash, NULL, key, len, &slot);
+	}
+	n = malloc(sizeof *n + len + 1);
+	if (!n)
+		goto fail;
+	n->hash = hash;
+	n->len = len;
+	n->id = id;
+	memcpy(n->key, key, len + 1);
+	__atomic_store_n(&t->chunks[c][i], n, __ATOMIC_RELEASE);
+	__atomic_store_n(&t->count, id + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&t->table->slots[slot], n, __ATOMIC_RELEASE);
+	unlock(t);
+	return id;
+fail:
+	unlock(t);
+	return -1;
+}
+
+__PUBLIC
+int
+json_intern_lookup(const struct json_intern *t, const char *key)
+{
+	size_t len = strlen(key);
+	const struct name *n;
+
+	n = find_name(current(t), hash_bytes(key, len), NULL, key, len, NULL);
+	if (!n) {
+		errno = ENOENT;
+		return -1;
+	}
+	return n->id;
+}
+
+__PUBLIC
+int
+json_intern_key_id(const struct json_intern *t, const __JSON char *json)
+{
+	const struct name *n;
+
+	skip_white(&json);
+	if (!json || (*json != '"' && *json != '\'' && !is_word_start(*json))) {
+		errno = EINVAL;
+		return -1;
+	}
+	n = find_name(current(t), hash_json_key(json), json, NULL, 0, NULL);
+	if (!n) {
+		errno = ENOENT;
+		return -1;
+	}
+	return n->id;
+}
+
+__PUBLIC
+const char *
+json_intern_name(const struct json_intern *t, int id)
+{
+	struct name **chunk;
+	size_t c, i;
+
+	if (id < 0 || id >= __atomic_load_n(&t->count, __ATOMIC_ACQUIRE)) {
+		errno = ENOENT;
+		return NULL;
+	}
+	c = chunk_of(id, &i);
+	chunk = __atomic_load_n(&t->chunks[c], __ATOMIC_ACQUIRE);
+	return __atomic_load_n(&chunk[i], __ATOMIC_ACQUIRE)->key;
+}
+
+__PUBLIC
+const __JSON char *
+json_object_next_id(const __JSON_OBJECTI char **ji,
+	const struct json_intern *t, int *id_return)
+{
+	const __JSON char *key;
+	const __JSON char *value;
+
+	value = json_object_next(ji, &key);
+	if (value) {
+		int save_errno = errno;
+		const struct name *n = find_name(current(t),
+		    hash_json_key(key), key, NULL, 0, NULL);
+		*id_return = n ? n->id : -1;
+		errno = save_errno;
+	}
+	return value;
+}
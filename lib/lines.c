@@ -0,0 +1,36 @@
+#include <errno.h>
+#include <string.h>
+
+#include "private.h"
+
+__PUBLIC
+const __JSON char *
+json_lines_next(const __JSON char **iter_ptr)
+{
+	const __JSON char *line = *iter_ptr;
+	const __JSON char *nl;
+	const __JSON char *record;
+
+	if (!line)
+		return NULL;
+
+	/* Only whole lines are consumed, so that a record still being
+	 * appended is left under the iterator for the next call. */
+	while ((nl = strchr(line, '\n'))) {
+		record = line;
+		skip_white(&record);
+		if (record > nl) {
+			line = nl + 1; /* blank line */
+			continue;
+		}
+		*iter_ptr = nl + 1;
+		return record;
+	}
+
+	/* Leave the iterator at the start of the unterminated line */
+	*iter_ptr = line;
+	skip_white(&line);
+	if (*line)
+		errno = EAGAIN;
+	return NULL;
+}
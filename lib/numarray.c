@@ -0,0 +1,163 @@
+#include <errno.h>
+#include <string.h>
+
+#include "private.h"
+
+__PUBLIC
+size_t
+json_as_float_array(const __JSON char *json, float *dst, size_t dstsz)
+{
+	const __JSON_ARRAYI char *ji;
+	size_t n = 0;
+	int invalid = 0;
+
+	ji = json_as_array(json);
+	if (!ji)
+		return 0;
+
+	/* Convert each element in place, like json_array_reduce_double() */
+	while (*ji && *ji != ']') {
+		const __JSON char *end;
+		float f;
+
+		end = scan_float(ji, &f);
+		if (end) {
+			ji = end;
+			skip_white(&ji);
+		} else {
+			f = json_as_float(ji);
+			invalid = 1;
+			if (!skip_value(&ji) && *ji != ',')
+				return 0;
+		}
+		if (n < dstsz)
+			dst[n] = f;
+		n++;
+		(void) can_skip_char(&ji, ',');
+	}
+	if (*ji != ']') {
+		errno = EINVAL; /* unterminated array */
+		return 0;
+	}
+
+	if (dstsz && n > dstsz) {
+		errno = ENOMEM;
+		return 0;
+	}
+	if (invalid)
+		errno = EINVAL;
+	return n;
+}
+
+/**
+ * Formats an array of numbers as a JSON array.
+ *
+ * Each element is formatted straight into the output buffer when
+ * there is room for the longest number, and otherwise into a
+ * scratch buffer from which it is copied.
+ *
+ * @param src     the numbers
+ * @param n       the number of elements in @a src
+ * @param format  formats element @a i of @a src into a buffer of
+ *                #FORMAT_NUMBER_SZ bytes, returning its length or 0
+ * @param dst     output buffer, will be NUL terminated
+ * @param dstsz   output buffer size, or 0 to indicate a size request
+ *
+ * @returns the minimum @a dstsz required (@a dstsz was 0), or
+ *          the number of bytes stored in @a dst including the NUL.
+ * @retval 0 [EINVAL] An element could not be formatted.
+ * @retval 0 [ENOMEM] The output buffer is too small.
+ */
+static size_t
+from_array(const void *src, size_t n,
+	size_t (*format)(const void *src, size_t i, __JSON char *buf),
+	__JSON char *dst, size_t dstsz)
+{
+	char scratch[FORMAT_NUMBER_SZ];
+	size_t outlen = 1;
+	size_t i;
+
+	if (dstsz)
+		*dst = '[';
+	for (i = 0; i < n; i++) {
+		__JSON char *out;
+		size_t len;
+
+		if (i) {
+			if (dstsz) {
+				if (outlen >= dstsz)
+					goto nomem;
+				dst[outlen] = ',';
+			}
+			outlen++;
+		}
+		if (dstsz && dstsz - outlen >= sizeof scratch)
+			out = dst + outlen;
+		else
+			out = scratch;
+		len = format(src, i, out);
+		if (!len)
+			goto fail;
+		if (dstsz && out == scratch) {
+			if (len >= dstsz - outlen)
+				goto nomem;
+			memcpy(dst + outlen, scratch, len);
+		}
+		outlen += len;
+	}
+	if (dstsz) {
+		if (dstsz - outlen < 2)
+			goto nomem;
+		dst[outlen] = ']';
+		dst[outlen + 1] = '\0';
+	}
+	return outlen + 2;
+nomem:
+	errno = ENOMEM;
+fail:
+	if (dstsz)
+		*dst = '\0';
+	return 0;
+}
+
+static size_t
+format_int64_at(const void *src, size_t i, __JSON char *buf)
+{
+	return format_int64(((const int64_t *)src)[i], buf);
+}
+
+static size_t
+format_double_at(const void *src, size_t i, __JSON char *buf)
+{
+	return format_double(((const double *)src)[i], buf);
+}
+
+static size_t
+format_float_at(const void *src, size_t i, __JSON char *buf)
+{
+	return format_float(((const float *)src)[i], buf);
+}
+
+__PUBLIC
+size_t
+json_from_int64_array(const int64_t *src, size_t n,
+	__JSON char *dst, size_t dstsz)
+{
+	return from_array(src, n, format_int64_at, dst, dstsz);
+}
+
+__PUBLIC
+size_t
+json_from_double_array(const double *src, size_t n,
+	__JSON char *dst, size_t dstsz)
+{
+	return from_array(src, n, format_double_at, dst, dstsz);
+}
+
+__PUBLIC
+size_t
+json_from_float_array(const float *src, size_t n,
+	__JSON char *dst, size_t dstsz)
+{
+	return from_array(src, n, format_float_at, dst, dstsz);
+}
@@ -2,6 +2,10 @@
 #include <errno.h>
 #include <math.h>		/* C99's isnan() and NAN are macros */
 #include <limits.h>		/* {INT,LONG}_{MIN,MAX} */
+#include <float.h>		/* FLT_EVAL_METHOD, {FLT,DBL}_{DIG,MIN} */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "private.h"
 
@@ -28,7 +32,6 @@ const_strtod(const char *nptr, const char **endptr)
  * @returns pointer to end of valid number
  * @retval NULL    when not a valid number (eg starts with '+')
  */
-static
 const __JSON char *
 scan_strict_number(const __JSON char *p)
 {
@@ -62,6 +65,421 @@ scan_strict_number(const __JSON char *p)
 	return p;
 }
 
+/* Const-corrected strtof */
+static float
+const_strtof(const char *nptr, const char **endptr)
+{
+	return strtof(nptr, (char **)endptr); /* see const_strtod() */
+}
+
+/* The powers of ten that are exactly representable as doubles */
+static const double exact_pow10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* The powers of ten that are exactly representable as floats */
+static const float exact_pow10f[] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f,
+	1e8f, 1e9f, 1e10f
+};
+
+/* The decimal significand and exponent of a JSON number */
+struct significand {
+	uint64_t mant;		/* up to 19 significant digits */
+	int exp10;		/* the number is mant * 10^exp10 */
+	int exact;		/* no non-zero digits were dropped */
+	int neg;
+};
+
+/**
+ * Splits a strictly valid JSON number into its significand and exponent.
+ *
+ * @param p  the text of a strictly valid JSON number
+ * @param s  storage for the split number
+ */
+static void
+scan_significand(const __JSON char *p, struct significand *s)
+{
+	int digits = 0;		/* significant digits in mant */
+
+	s->mant = 0;
+	s->exp10 = 0;
+	s->exact = 1;
+	s->neg = 0;
+	if (*p == '-') {
+		s->neg = 1;
+		p++;
+	}
+	for (; isdigit(*p); p++) {
+		if (digits < 19) {
+			s->mant = s->mant * 10 + (*p - '0');
+			if (s->mant)
+				digits++;
+		} else {
+			if (*p != '0')
+				s->exact = 0;
+			s->exp10++;
+		}
+	}
+	if (*p == '.')
+		for (p++; isdigit(*p); p++) {
+			if (digits < 19) {
+				s->mant = s->mant * 10 + (*p - '0');
+				if (s->mant)
+					digits++;
+				s->exp10--;
+			} else if (*p != '0')
+				s->exact = 0;
+		}
+	if (*p == 'e' || *p == 'E') {
+		int eneg = 0;
+		int e = 0;
+		p++;
+		if (*p == '-' || *p == '+')
+			eneg = (*p++ == '-');
+		for (; isdigit(*p); p++)
+			if (e < 10000)
+				e = e * 10 + (*p - '0');
+		s->exp10 += eneg ? -e : e;
+	}
+}
+
+/**
+ * Scans a strictly valid JSON number and converts it to a double.
+ *
+ * Numbers whose decimal significand fits in 53 bits, and that have
+ * a small exponent, are converted by a single exact multiplication or
+ * division, which is correctly rounded (Clinger, 1990). This avoids the cost of
+ * @c strtod(), which is used for all other numbers.
+ *
+ * @param p         JSON text (not whitespace)
+ * @param d_return  storage for the converted number
+ *
+ * @returns pointer to the end of the number
+ * @retval NULL The text is not a strict JSON number.
+ */
+const __JSON char *
+scan_double(const __JSON char *p, double *d_return)
+{
+	const __JSON char *end;
+	struct significand s;
+
+	end = scan_strict_number(p);
+	if (!end)
+		return NULL;
+
+	scan_significand(p, &s);
+#if FLT_EVAL_METHOD == 0
+	if (s.exact && s.mant <= ((uint64_t)1 << 53) &&
+	    s.exp10 >= -22 && s.exp10 <= 22)
+	{
+		double d = s.mant;
+		if (s.exp10 < 0)
+			d /= exact_pow10[-s.exp10];
+		else
+			d *= exact_pow10[s.exp10];
+		*d_return = s.neg ? -d : d;
+		return end;
+	}
+#endif
+	*d_return = const_strtod(p, NULL);
+	return end;
+}
+
+/**
+ * Scans a strictly valid JSON number and converts it to a float.
+ *
+ * This is the single-precision version of #scan_double().
+ * The fast path applies to significands of up to 24 bits with
+ * exponents in [-10, 10], so most short decimals avoid @c strtof().
+ * Converting directly avoids the double rounding of narrowing a
+ * double.
+ *
+ * @param p         JSON text (not whitespace)
+ * @param f_return  storage for the converted number
+ *
+ * @returns pointer to the end of the number
+ * @retval NULL The text is not a strict JSON number.
+ */
+const __JSON char *
+scan_float(const __JSON char *p, float *f_return)
+{
+	const __JSON char *end;
+	struct significand s;
+
+	end = scan_strict_number(p);
+	if (!end)
+		return NULL;
+
+	scan_significand(p, &s);
+#if FLT_EVAL_METHOD == 0
+	if (s.exact && s.mant <= ((uint64_t)1 << 24) &&
+	    s.exp10 >= -10 && s.exp10 <= 10)
+	{
+		float f = s.mant;
+		if (s.exp10 < 0)
+			f /= exact_pow10f[-s.exp10];
+		else
+			f *= exact_pow10f[s.exp10];
+		*f_return = s.neg ? -f : f;
+		return end;
+	}
+#endif
+	*f_return = const_strtof(p, NULL);
+	return end;
+}
+
+/* Two-digit strings for "00" .. "99" */
+static const char digit_pairs[] =
+	"00010203040506070809" "10111213141516171819"
+	"20212223242526272829" "30313233343536373839"
+	"40414243444546474849" "50515253545556575859"
+	"60616263646566676869" "70717273747576777879"
+	"80818283848586878889" "90919293949596979899";
+
+/** Returns the number of decimal digits in an integer. */
+static int
+count_digits(uint64_t u)
+{
+	uint64_t p = 10;
+	int n = 1;
+
+	while (n < 20 && u >= p) {
+		n++;
+		p *= 10;
+	}
+	return n;
+}
+
+/**
+ * Stores the decimal digits of an integer, two digits at a time.
+ *
+ * @param u    the integer
+ * @param end  where the digits are to end
+ */
+static void
+put_digits(uint64_t u, __JSON char *end)
+{
+	while (u >= 100) {
+		end -= 2;
+		memcpy(end, &digit_pairs[2 * (u % 100)], 2);
+		u /= 100;
+	}
+	if (u >= 10) {
+		end -= 2;
+		memcpy(end, &digit_pairs[2 * u], 2);
+	} else
+		*--end = '0' + u;
+}
+
+/**
+ * Formats an integer as a JSON number.
+ *
+ * @param value  the integer
+ * @param buf    output buffer of #FORMAT_NUMBER_SZ bytes. It is not
+ *               NUL terminated.
+ *
+ * @returns the number of bytes stored
+ */
+size_t
+format_int64(int64_t value, __JSON char *buf)
+{
+	uint64_t u = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+	size_t len = (value < 0) + count_digits(u);
+
+	put_digits(u, buf + len);
+	if (value < 0)
+		*buf = '-';
+	return len;
+}
+
+/**
+ * Formats the decimal m * 10^-k without an exponent.
+ *
+ * @param neg  nonzero if a minus sign is needed
+ * @param m    the significand
+ * @param k    the number of fraction digits
+ * @param buf  output buffer of #FORMAT_NUMBER_SZ bytes
+ *
+ * @returns the number of bytes stored
+ */
+static size_t
+put_scaled(int neg, uint64_t m, int k, __JSON char *buf)
+{
+	int ndigits = count_digits(m);
+	__JSON char *p = buf;
+
+	if (neg)
+		*p++ = '-';
+	if (!k) {
+		put_digits(m, p + ndigits);
+		return neg + ndigits;
+	}
+	if (ndigits > k) {
+		/* Store the digits one to the right, then shift
+		 * the integer part left to make room for the point */
+		put_digits(m, p + ndigits + 1);
+		memmove(p, p + 1, ndigits - k);
+		p[ndigits - k] = '.';
+		return neg + ndigits + 1;
+	}
+	p[0] = '0';
+	p[1] = '.';
+	memset(p + 2, '0', k - ndigits);
+	put_digits(m, p + 2 + k);
+	return neg + 2 + k;
+}
+
+/**
+ * Formats a number with @c snprintf() using the fewest significant
+ * digits in a range that read back as the same number.
+ *
+ * Every decimal of up to @c DBL_DIG (or @c FLT_DIG) digits reads back
+ * as a distinct normal number, so fewer are never tried for those.
+ * Subnormals have less precision, and may need as few as one.
+ *
+ * @param d        the number
+ * @param isfloat  nonzero if @a d must read back as a float
+ * @param buf      output buffer of #FORMAT_NUMBER_SZ bytes
+ *
+ * @returns the number of bytes stored
+ */
+static size_t
+print_shortest(double d, int isfloat, __JSON char *buf)
+{
+	int precision = isfloat ? FLT_DIG : DBL_DIG;
+	int max_precision = isfloat ? 9 : 17;
+	int len;
+	char *p;
+
+	if (fabs(d) < (isfloat ? FLT_MIN : DBL_MIN))
+		precision = 1;
+
+	for (;; precision++) {
+		len = snprintf(buf, FORMAT_NUMBER_SZ, "%.*g", precision, d);
+		if (precision == max_precision)
+			break;
+		if (isfloat ? const_strtof(buf, NULL) == (float)d
+			    : const_strtod(buf, NULL) == d)
+			break;
+	}
+	/* Undo a locale's decimal comma */
+	for (p = buf; *p; p++)
+		if (*p == ',')
+			*p = '.';
+	return len;
+}
+
+/**
+ * Tests if a double lies exactly halfway between two floats.
+ *
+ * Such a double has exactly 25 significant bits. Veltkamp's split
+ * rounds it to 25 bits, which leaves it unchanged.
+ */
+static int
+is_float_midpoint(double q)
+{
+	double c = q * (double)((1 << 28) + 1);
+	double hi = c - (c - q);
+
+	return hi == q && (double)(float)q != q;
+}
+
+/**
+ * Formats a finite double as a JSON number, using the fewest
+ * significant digits that convert back to the same double.
+ *
+ * Numbers with up to 16 significant digits and a magnitude between
+ * 1e-6 and 2^53 are found without @c snprintf(), by finding the
+ * smallest power of ten k for which d * 10^k rounds to an integer m
+ * such that m / 10^k == d. Because m and 10^k are exact, that division
+ * is correctly rounded, just as converting "m e-k" back is by
+ * #scan_double().
+ *
+ * @param d    the number
+ * @param buf  output buffer of #FORMAT_NUMBER_SZ bytes. It is not
+ *             NUL terminated.
+ *
+ * @returns the number of bytes stored
+ * @retval 0 [EINVAL] The number is infinite or NaN.
+ */
+size_t
+format_double(double d, __JSON char *buf)
+{
+	double a = d < 0 ? -d : d;
+	int k;
+
+	if (isnan(d) || isinf(d)) {
+		errno = EINVAL;
+		return 0;
+	}
+	if (a == 0)
+		return put_scaled(signbit(d) != 0, 0, 0, buf);
+#if FLT_EVAL_METHOD == 0
+	if (a >= 1e-6 && a < 0x1p53)
+		for (k = 0; k <= 22; k++) {
+			double s = a * exact_pow10[k];
+			uint64_t m;
+			if (s >= 0x1p53)
+				break;
+			m = s + 0.5;
+			if ((double)m / exact_pow10[k] == a)
+				return put_scaled(d < 0, m, k, buf);
+		}
+#endif
+	return print_shortest(d, 0, buf);
+}
+
+/**
+ * Formats a finite float as a JSON number, using the fewest
+ * significant digits that convert back to the same float.
+ *
+ * This is the single-precision version of #format_double().
+ * Above 2^24, floats are more than 1 apart and so may have a shorter
+ * form than their integer value, which is left to @c snprintf().
+ * The quotient m / 10^k is correctly rounded to a double, and then to
+ * a float. The second rounding agrees with rounding m / 10^k directly
+ * to a float, except when the double lands exactly halfway between
+ * two floats. Those rare cases are left to @c snprintf().
+ *
+ * @param f    the number
+ * @param buf  output buffer of #FORMAT_NUMBER_SZ bytes. It is not
+ *             NUL terminated.
+ *
+ * @returns the number of bytes stored
+ * @retval 0 [EINVAL] The number is infinite or NaN.
+ */
+size_t
+format_float(float f, __JSON char *buf)
+{
+	double a = f < 0 ? -(double)f : f;
+	int k;
+
+	if (isnan(f) || isinf(f)) {
+		errno = EINVAL;
+		return 0;
+	}
+	if (a == 0)
+		return put_scaled(signbit(f) != 0, 0, 0, buf);
+#if FLT_EVAL_METHOD == 0
+	if (a >= 1e-6 && a < 0x1p24)
+		for (k = 0; k <= 22; k++) {
+			double s = a * exact_pow10[k];
+			uint64_t m;
+			double q;
+			if (s >= 1e9)
+				break;
+			m = s + 0.5;
+			q = (double)m / exact_pow10[k];
+			if ((float)q == (float)a && !is_float_midpoint(q))
+				return put_scaled(f < 0, m, k, buf);
+		}
+#endif
+	return print_shortest(f, 1, buf);
+}
+
 __PUBLIC
 double
 json_as_double(const __JSON char *json)
@@ -113,6 +531,42 @@ json_as_double(const __JSON char *json)
 	return number;
 }
 
+__PUBLIC
+float
+json_as_float(const __JSON char *json)
+{
+	const __JSON char *end = NULL;
+	float number;
+
+	if (!json) {
+		errno = EINVAL;
+		return NAN;
+	}
+	skip_white(&json);
+
+	if (scan_float(json, &number))
+		return number;
+
+	/* Everything else is handled as by json_as_double() */
+	if (*json == '"' || *json == '\'') {
+		__JSON char quote = *json++;
+		number = const_strtof(json, &end);
+		if (end == json)
+			number = NAN;
+		else {
+			skip_white(&end);
+			if (*end != quote)
+				number = NAN;
+		}
+	} else {
+		number = const_strtof(json, &end);
+		if (end == json)
+			number = NAN;
+	}
+	errno = EINVAL;
+	return number;
+}
+
 __PUBLIC
 long
 json_as_long(const __JSON char *json)
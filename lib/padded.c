@@ -0,0 +1,32 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "private.h"
+
+__PUBLIC
+char *
+json_padded_alloc(size_t len)
+{
+	char *buf;
+
+	if (len > SIZE_MAX - 1 - JSON_PADDING) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	buf = malloc(len + 1 + JSON_PADDING);
+	if (buf)
+		memset(buf + len, 0, 1 + JSON_PADDING);
+	return buf;
+}
+
+__PUBLIC
+char *
+json_padded_strndup(const char *src, size_t len)
+{
+	char *buf = json_padded_alloc(len);
+
+	if (buf)
+		memcpy(buf, src, len);
+	return buf;
+}
@@ -7,6 +7,13 @@
 #define __PUBLIC /* indicates the function is part of public API */
 #define __PURE   __attribute__ ((pure))
 
+/* Hints that memory will soon be read */
+#ifdef __GNUC__
+# define prefetch(p)	__builtin_prefetch(p)
+#else
+# define prefetch(p)	((void)(p))
+#endif
+
 /* Hide some functions private to the library */
 #define is_delimiter		_redjson_is_delimiter
 #define is_word_start		_redjson_is_word_start
@@ -14,8 +21,33 @@
 #define skip_white		_redjson_skip_white
 #define can_skip_char		_redjson_can_skip_char
 #define skip_value		_redjson_skip_value
+#define skip_value_padded	_redjson_skip_value_padded
 #define word_strcmpn		_redjson_word_strcmpn
 #define word_strcmp		_redjson_word_strcmp
+#define next_path_component	_redjson_next_path_component
+#define scan_strict_number	_redjson_scan_strict_number
+#define scan_double		_redjson_scan_double
+#define scan_float		_redjson_scan_float
+#define select_component	_redjson_select_component
+#define key_caseeq		_redjson_key_caseeq
+#define hash_bytes		_redjson_hash_bytes
+#define hash_json_key		_redjson_hash_json_key
+#define ascii_span		_redjson_ascii_span
+#define byte_span		_redjson_byte_span
+#define hex_encode		_redjson_hex_encode
+#define base64_encode		_redjson_base64_encode
+#define hex_to_char		_redjson_hex_to_char
+#define base64_to_char		_redjson_base64_to_char
+#define format_int64		_redjson_format_int64
+#define format_double		_redjson_format_double
+#define format_float		_redjson_format_float
+#define key_strcmp		_redjson_key_strcmp
+#define sort_members		_redjson_sort_members
+#define big_alloc		_redjson_big_alloc
+#define big_realloc		_redjson_big_realloc
+#define big_free		_redjson_big_free
+#define image_alloc		_redjson_image_alloc
+#define image_text		_redjson_image_text
 
 int is_delimiter(__JSON char ch) __PURE;
 int is_word_start(__JSON char ch) __PURE;
@@ -24,8 +56,53 @@ int is_word_char(__JSON char ch) __PURE;
 void skip_white(const __JSON char **json_ptr);
 int can_skip_char(const __JSON char **json_ptr, char ch);
 int skip_value(const __JSON char **json_ptr);
+int skip_value_padded(const __JSON char **json_ptr);
 
 int word_strcmpn(const __JSON char *json, const char *str, size_t strsz);
 int word_strcmp(const __JSON char *json, const char *str);
 
+const __JSON char *scan_strict_number(const __JSON char *p);
+const __JSON char *scan_double(const __JSON char *p, double *d_return);
+const __JSON char *scan_float(const __JSON char *p, float *f_return);
+
+/* The size of buffer that the format_*() functions need */
+#define FORMAT_NUMBER_SZ	32
+size_t format_int64(int64_t value, __JSON char *buf);
+size_t format_double(double d, __JSON char *buf);
+size_t format_float(float f, __JSON char *buf);
+
+/* A parsed component of a selection path */
+struct path_component {
+	const char *key;	/* key to match, or NULL for an array index */
+	size_t keylen;		/* length of the key */
+	unsigned index;		/* array index, when key is NULL */
+	int fold;		/* nonzero to match the key ignoring case */
+};
+int next_path_component(const char **path_ptr, int first, va_list *app,
+	struct path_component *pc);
+const __JSON char *select_component(const __JSON char *json,
+	const struct path_component *pc);
+int key_caseeq(const __JSON char *json, const char *key, size_t keylen);
+int key_strcmp(const __JSON char *json, const char *str, size_t len,
+	int prefix);
+void sort_members(const __JSON char *object, uint32_t *offsets, size_t n);
+
+size_t ascii_span(const char *p, size_t len, const char stop[4]);
+size_t byte_span(const char *p, size_t len, const char stop[4]);
+void hex_encode(const unsigned char *src, size_t n, char *dst);
+void base64_encode(const unsigned char *src, size_t n, char *dst);
+extern const char hex_to_char[16];
+extern const char base64_to_char[64];
+
+void *big_alloc(size_t len);
+void *big_realloc(void *p, size_t len);
+void big_free(void *p);
+
+void *image_alloc(const __JSON char *json, uint64_t generation,
+	size_t before, size_t *size_ret);
+const __JSON char *image_text(const void *image);
+
+uint64_t hash_bytes(const void *key, size_t keylen);
+uint64_t hash_json_key(const __JSON char *json);
+
 #endif /* REDJSON_PRIVATE_H */
@@ -0,0 +1,57 @@
+#include <errno.h>
+#include <math.h>		/* C99's NAN and INFINITY are macros */
+
+#include "private.h"
+
+__PUBLIC
+int
+json_array_reduce_double(const __JSON char *json, int flags,
+	struct json_reduce *out)
+{
+	const __JSON_ARRAYI char *ji;
+	double sum = 0;
+	double min = INFINITY;
+	double max = -INFINITY;
+	size_t count = 0;
+	size_t skipped = 0;
+
+	ji = json_as_array(json);
+	if (!ji)
+		return -1;
+
+	/* Convert each element in place, instead of skipping
+	 * over it and then scanning it again to convert it */
+	while (*ji && *ji != ']') {
+		const __JSON char *end;
+		double d;
+
+		end = scan_double(ji, &d);
+		if (end) {
+			count++;
+			sum += d;
+			if (d < min)
+				min = d;
+			if (d > max)
+				max = d;
+			ji = end;
+			skip_white(&ji);
+		} else {
+			skipped++;
+			if (!skip_value(&ji) && *ji != ',')
+				return -1;
+		}
+		(void) can_skip_char(&ji, ',');
+	}
+	if (*ji != ']') {
+		errno = EINVAL; /* unterminated array */
+		return -1;
+	}
+
+	out->count = count;
+	out->skipped = skipped;
+	out->sum = (flags & JSON_REDUCE_SUM) ? sum : NAN;
+	out->min = (flags & JSON_REDUCE_MIN) && count ? min : NAN;
+	out->max = (flags & JSON_REDUCE_MAX) && count ? max : NAN;
+	out->mean = (flags & JSON_REDUCE_MEAN) && count ? sum / count : NAN;
+	return 0;
+}
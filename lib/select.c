@@ -5,119 +5,339 @@
 
 #include "private.h"
 
-__PUBLIC
-const __JSON char *
-json_selectv(const __JSON char *json, const char *path, va_list ap)
+/**
+ * Parses the next component of a selection path.
+ *
+ * @param path_ptr  pointer to the unparsed selection path (not empty).
+ *                  It is advanced over the component on success.
+ * @param first     nonzero if this is the path's first component,
+ *                  which may omit its leading '.'
+ * @param app       (optional) pointer to the arguments for any
+ *                  <code>.%s</code>, <code>[%d]</code> and
+ *                  <code>[%u]</code> references.
+ *                  If @c NULL, argument references are malformed.
+ * @param pc        storage for the parsed component
+ *
+ * @retval 1 The component was parsed.
+ * @retval 0 [EINVAL] The path is malformed.
+ * @retval -1 A <code>[%d]</code> argument was negative, and
+ *            will select nothing.
+ */
+int
+next_path_component(const char **path_ptr, int first, va_list *app,
+	struct path_component *pc)
 {
+	const char *path = *path_ptr;
 	unsigned index;
-	int keylen;
-	const char *ji;
-	const char *key;
-	const char *cur_key;
-	int first = 1;
 
-	/* Walk the structure as we process the path components */
-	while (json && *path) {
-		switch (*path) {
-		case '[':
-			/* array index component "[int]" */
-			path++;
-			if (path[0] == '%' && path[1] == 'd') {
-				int arg;
-				path += 2;
-				arg = va_arg(ap, int);
-				if (arg < 0) {
-					json = NULL;
-					break;
-				}
-				index = arg;
-			} else if (path[0] == '%' && path[1] == 'u') {
-				path += 2;
-				index = va_arg(ap, unsigned int);
-			} else {
-				index = 0;
-				if (*path == '+')
-					path++;
-				if (!isdigit(*path))
-					goto einval;
-				while (isdigit(*path)) {
-					if (index == (UINT_MAX / 10) &&
-					    (*path - '0') > (UINT_MAX % 10))
-						goto einval; /* overflow */
-					index = index * 10 + (*path - '0');
-					path++;
-				}
-			}
-			if (*path++ != ']')
+	switch (*path) {
+	case '[':
+		/* array index component "[int]" */
+		path++;
+		if (app && path[0] == '%' && path[1] == 'd') {
+			int arg;
+			path += 2;
+			arg = va_arg(*app, int);
+			if (arg < 0)
+				return -1;
+			index = arg;
+		} else if (app && path[0] == '%' && path[1] == 'u') {
+			path += 2;
+			index = va_arg(*app, unsigned int);
+		} else {
+			index = 0;
+			if (*path == '+')
+				path++;
+			if (!isdigit(*path))
 				goto einval;
-			/* Skip the first 'index' values in the array */
-			ji = json_as_array(json);
-			if (!ji)
-				goto enoent;
-			errno = 0;
-			while ((json = json_array_next(&ji))) {
-				if (!index--)
-					break;
+			while (isdigit(*path)) {
+				if (index == (UINT_MAX / 10) &&
+				    (*path - '0') > (UINT_MAX % 10))
+					goto einval; /* overflow */
+				index = index * 10 + (*path - '0');
+				path++;
 			}
-			if (errno)
-				return NULL;
-			break;
-		default:
-			/* First components simulate a leading '.' */
-			if (!first)
+		}
+		if (*path++ != ']')
+			goto einval;
+		pc->key = NULL;
+		pc->index = index;
+		pc->fold = 0;
+		break;
+	default:
+		/* First components simulate a leading '.' */
+		if (!first)
+			goto einval;
+		path--;
+	case '.':
+		/* Object field component ".key" */
+		path++;
+		if (app && path[0] == '%' && path[1] == 's')
+		{
+			path += 2;
+			if (!strchr("[.", *path))
 				goto einval;
-			path--;
-		case '.':
-			/* Object field component ".key" */
-			path++;
-			if (path[0] == '%' && path[1] == 's')
-			{
-				path += 2;
-				if (!strchr("[.", *path))
-					goto einval;
-				key = va_arg(ap, const char *);
-				if (!key)
-					goto einval;
-				keylen = strlen(key);
-			} else {
-				key = path;
-				while (!strchr("[.", *path)) {
-					if (*path == '%')
-						goto einval;
-					path++;
-				}
-				keylen = path - key;
-				/* Literal empty .<key> is ambiguous */
-				if (!keylen)
+			pc->key = va_arg(*app, const char *);
+			if (!pc->key)
+				goto einval;
+			pc->keylen = strlen(pc->key);
+		} else {
+			pc->key = path;
+			while (!strchr("[.", *path)) {
+				if (*path == '%')
 					goto einval;
+				path++;
 			}
-			/* Skip to the first matching key in the object */
-			ji = json_as_object(json);
-			if (!ji)
-				goto enoent;
-			errno = 0;
-			while ((json = json_object_next(&ji, &cur_key))) {
-				if (json_strcmpn(cur_key, key, keylen) == 0)
-					break;
-			}
-			if (errno)
-				return NULL;
-			break;
+			pc->keylen = path - pc->key;
+			/* Literal empty .<key> is ambiguous */
+			if (!pc->keylen)
+				goto einval;
+		}
+		pc->fold = 0;
+		break;
+	}
+	*path_ptr = path;
+	return 1;
+einval:
+	errno = EINVAL;
+	return 0;
+}
+
+/** Tests if an object member's key matches a path component */
+static int
+key_matches(const __JSON char *key, const struct path_component *pc)
+{
+	int save_errno = errno;
+	int cmp;
+
+	if (pc->fold)
+		return key_caseeq(key, pc->key, pc->keylen);
+	cmp = json_strcmpn(key, pc->key, pc->keylen);
+	errno = save_errno; /* words set EINVAL */
+	return cmp == 0;
+}
+
+/**
+ * Selects a value by one component of a selection path.
+ *
+ * @param json  (optional) JSON value to select within
+ * @param pc    the path component to match
+ *
+ * @returns pointer within @a json to the selected value
+ * @retval NULL [ENOENT] The component was not found in the value.
+ * @retval NULL [ENOMEM] The input is too deeply nested.
+ * @retval NULL [EINVAL] The value is malformed.
+ */
+const __JSON char *
+select_component(const __JSON char *json, const struct path_component *pc)
+{
+	const char *ji;
+	const char *cur_key;
+	unsigned index;
+
+	if (!pc->key) {
+		/* Skip the first 'index' values in the array */
+		ji = json_as_array(json);
+		if (!ji)
+			goto enoent;
+		index = pc->index;
+		errno = 0;
+		while ((json = json_array_next(&ji))) {
+			if (!index--)
+				break;
 		}
+	} else {
+		/* Skip to the first matching key in the object */
+		ji = json_as_object(json);
+		if (!ji)
+			goto enoent;
+		errno = 0;
+		while ((json = json_object_next(&ji, &cur_key))) {
+			if (key_matches(cur_key, pc))
+				break;
+		}
+	}
+	if (errno)
+		return NULL;
+	if (json)
+		return json;
+enoent:
+	errno = ENOENT;
+	return NULL;
+}
+
+/**
+ * Selects an element within a JSON structure.
+ *
+ * @param json  (optional) JSON value to select within
+ * @param path  selection path, see #json_select()
+ * @param ap    arguments for the path's argument references
+ * @param fold  nonzero to match keys ignoring case
+ *
+ * @returns pointer within @a json to the selected value, see #json_select()
+ */
+static const __JSON char *
+select_path(const __JSON char *json, const char *path, va_list ap, int fold)
+{
+	struct path_component pc;
+	int first = 1;
+	va_list aq;
+
+	/* Take a copy so that the arguments can be passed by reference */
+	va_copy(aq, ap);
+
+	/* Walk the structure as we process the path components */
+	while (json && *path) {
+		switch (next_path_component(&path, first, &aq, &pc)) {
+		case 0:
+			goto fail;
+		case -1:
+			errno = ENOENT;
+			goto fail;
+		}
+		pc.fold = fold;
+		json = select_component(json, &pc);
+		if (!json)
+			goto fail;
 		first = 0;
 	}
+	va_end(aq);
 	if (json) {
 		errno = 0;
 		return json;
 	}
-enoent:
 	errno = ENOENT;
 	return NULL;
-einval:
-	errno = EINVAL;
+fail:
+	va_end(aq);
 	return NULL;
 }
 
+__PUBLIC
+const __JSON char *
+json_selectv(const __JSON char *json, const char *path, va_list ap)
+{
+	return select_path(json, path, ap, 0);
+}
+
+__PUBLIC
+const __JSON char *
+json_iselectv(const __JSON char *json, const char *path, va_list ap)
+{
+	return select_path(json, path, ap, 1);
+}
+
+/* Number of documents whose selections are interleaved */
+#define BATCH_GROUP 8
+
+/**
+ * Applies one path component to a group of documents, interleaving
+ * their scans one member or element at a time.
+ *
+ * Each step of a scan depends on the previous one, so a single scan
+ * leaves the processor idle on every cache miss. Stepping through the
+ * documents in turn gives it independent work to overlap with the miss,
+ * and the prefetch of each document's next position is issued a whole
+ * round of steps before it is needed.
+ *
+ * @param cur  the group's values. Each is replaced by the value that
+ *             the component selects, or @c NULL.
+ * @param m    the number of values in @a cur
+ * @param pc   the path component
+ */
+static void
+select_group(const __JSON char *cur[], size_t m,
+	const struct path_component *pc)
+{
+	const char *ji[BATCH_GROUP];
+	unsigned index[BATCH_GROUP];
+	size_t active = 0;
+	size_t i;
+
+	for (i = 0; i < m; i++) {
+		ji[i] = NULL;
+		if (!cur[i])
+			continue;
+		ji[i] = pc->key ? json_as_object(cur[i])
+				: json_as_array(cur[i]);
+		index[i] = pc->index;
+		cur[i] = NULL;
+		if (ji[i]) {
+			prefetch(ji[i]);
+			active++;
+		}
+	}
+	while (active) {
+		for (i = 0; i < m; i++) {
+			const __JSON char *value;
+			const __JSON char *key;
+			int found;
+
+			if (!ji[i])
+				continue;
+			if (pc->key) {
+				value = json_object_next(&ji[i], &key);
+				found = value && key_matches(key, pc);
+			} else {
+				value = json_array_next(&ji[i]);
+				found = value && !index[i]--;
+			}
+			if (found)
+				cur[i] = value;
+			if (!value || found) {
+				ji[i] = NULL;
+				active--;
+			} else
+				prefetch(ji[i]);
+		}
+	}
+}
+
+__PUBLIC
+size_t
+json_select_batch(const __JSON char *const docs[], size_t n,
+	const char *path, const __JSON char *out[])
+{
+	struct path_component pc;
+	const char *p;
+	size_t base;
+	size_t found = 0;
+	size_t i;
+	int first;
+
+	/* Check the whole path before selecting anything */
+	for (p = path, first = 1; *p; first = 0)
+		if (next_path_component(&p, first, NULL, &pc) != 1) {
+			for (i = 0; i < n; i++)
+				out[i] = NULL;
+			return 0;
+		}
+
+	/*
+	 * Each path component is applied to a group of documents
+	 * before the next component is applied, with the scans of
+	 * the documents in the group interleaved step by step.
+	 */
+	for (base = 0; base < n; base += BATCH_GROUP) {
+		const __JSON char **cur = out + base;
+		size_t m = n - base < BATCH_GROUP ? n - base : BATCH_GROUP;
+
+		for (i = 0; i < m; i++) {
+			cur[i] = docs[base + i];
+			prefetch(cur[i]);
+		}
+		for (p = path, first = 1; *p; first = 0) {
+			(void) next_path_component(&p, first, NULL, &pc);
+			select_group(cur, m, &pc);
+		}
+		for (i = 0; i < m; i++)
+			if (cur[i])
+				found++;
+	}
+	errno = 0;
+	return found;
+}
+
 __PUBLIC
 const __JSON char *
 json_select(const __JSON char *json, const char *path, ...)
@@ -131,6 +351,19 @@ json_select(const __JSON char *json, const char *path, ...)
 	return ret;
 }
 
+__PUBLIC
+const __JSON char *
+json_iselect(const __JSON char *json, const char *path, ...)
+{
+	va_list ap;
+	const char *ret;
+
+	va_start(ap, path);
+	ret = json_iselectv(json, path, ap);
+	va_end(ap);
+	return ret;
+}
+
 /* Implement a json_default_select_* select & convert */
 #define IMPL_DEFAULT_SELECT(NAME, T, CONV)				\
     __PUBLIC								\
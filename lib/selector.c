@@ -0,0 +1,344 @@
+#include <errno.h>
+#include <string.h>
+
+#include "private.h"
+
+/* What the selector's offset points at */
+enum {
+	AT_VALUE = 0,	/* a value to apply the rest of the path to */
+	AT_ARRAY,	/* a value expected to be an array */
+	AT_OBJECT,	/* a value expected to be an object */
+	IN_ARRAY,	/* an array element, or the closing ] */
+	IN_OBJECT	/* an object member, or the closing } */
+};
+
+/* Progress of skipping a value */
+enum {
+	SKIP_NONE = 0,	/* not started */
+	SKIP_VALUE,	/* within the value, between tokens */
+	SKIP_WORD,	/* within an unquoted word */
+	SKIP_DONE	/* the scan offset is just after the value */
+};
+
+#define WHITESPACE " \t\n\r"
+
+__PUBLIC
+void
+json_selector_init(struct json_selector *sel, const char *path)
+{
+	sel->path = path;
+	sel->key = NULL;
+	sel->keylen = 0;
+	sel->index = 0;
+	sel->offset = 0;
+	sel->state = AT_VALUE;
+	sel->first = 1;
+	sel->value = 0;
+	sel->skip = SKIP_NONE;
+}
+
+/**
+ * Skips a value, resuming where an earlier call ran out of text.
+ *
+ * The scan remembers the nesting of the open arrays and objects, and
+ * whether it stopped within a word, a string or an escape sequence,
+ * so that no byte is examined twice. When the skip is done, later
+ * calls return at once until the caller resets @c sel->skip.
+ *
+ * @param sel    the selection state
+ * @param json   JSON text received so far
+ * @param start  where the value starts (not whitespace), used when
+ *               the skip has not yet started
+ * @param final  nonzero if no more text will be appended to @a json
+ *
+ * @retval 1 The value was skipped. @c sel->scan is the offset just
+ *           after it.
+ * @retval 0 [EAGAIN] More text is needed to find the end of the value.
+ * @retval -1 [EINVAL] The text is not a value.
+ * @retval -1 [ENOMEM] The value is too deeply nested.
+ */
+static int
+skip_partial(struct json_selector *sel, const __JSON char *json,
+    const __JSON char *start, int final)
+{
+	const __JSON char *p;
+
+	if (sel->skip == SKIP_DONE)
+		return 1;
+	if (sel->skip == SKIP_NONE) {
+		sel->scan = start - json;
+		sel->depth = 0;
+		sel->quote = 0;
+		sel->escape = 0;
+		sel->skip = SKIP_VALUE;
+	}
+	for (p = json + sel->scan; ; p++) {
+		__JSON char ch = *p;
+		size_t d;
+
+		if (!ch) {
+			if (final)
+				break;	/* the end of input ends the value */
+			sel->scan = p - json;
+			errno = EAGAIN;
+			return 0;
+		}
+		if (sel->quote) {
+			if (sel->escape)
+				sel->escape = 0;
+			else if (ch == '\\')
+				sel->escape = 1;
+			else if (ch == sel->quote) {
+				sel->quote = 0;
+				if (!sel->depth) {
+					p++;
+					break;
+				}
+			}
+			continue;
+		}
+		if (sel->skip == SKIP_WORD) {
+			if (is_word_char(ch))
+				continue;
+			sel->skip = SKIP_VALUE;
+			if (!sel->depth)
+				break;
+		}
+		if (ch == '"' || ch == '\'') {
+			sel->quote = ch;
+			continue;
+		}
+		if (is_word_start(ch)) {
+			sel->skip = SKIP_WORD;
+			continue;
+		}
+		d = sel->depth;
+		if (ch == '[' || ch == '{') {
+			if (d == 8 * sizeof sel->nest) {
+				errno = ENOMEM;
+				return -1;
+			}
+			if (ch == '[')
+				sel->nest[d / 8] |= 1 << (d % 8);
+			else
+				sel->nest[d / 8] &= ~(1 << (d % 8));
+			sel->depth++;
+			continue;
+		}
+		if (!d)
+			goto einval;	/* not the start of a value */
+		d--;
+		if (ch == ']' || ch == '}') {
+			if (!(sel->nest[d / 8] & (1 << (d % 8))) != (ch == '}'))
+				goto einval;	/* wrong close */
+			sel->depth = d;
+			if (!d) {
+				p++;
+				break;
+			}
+			continue;
+		}
+		if (ch != ',' && ch != ':' && !strchr(WHITESPACE, ch))
+			goto einval;
+	}
+	sel->scan = p - json;
+	sel->skip = SKIP_DONE;
+	return 1;
+einval:
+	errno = EINVAL;
+	return -1;
+}
+
+/**
+ * Finds the text after a skipped value and its whitespace.
+ *
+ * @returns pointer within @a json to the following text, which is
+ *          the NUL if none has arrived yet
+ */
+static const __JSON char *
+after_skip(struct json_selector *sel, const __JSON char *json)
+{
+	const __JSON char *q = json + sel->scan;
+
+	skip_white(&q);
+	sel->scan = q - json;
+	return q;
+}
+
+/**
+ * Advances a selection as far as the available JSON text allows.
+ *
+ * The selector's offset is only ever advanced over text that
+ * is known to be complete, that is text followed by something
+ * other than the terminating NUL.
+ *
+ * @param sel   the selection state
+ * @param json  (optional) JSON text received so far
+ * @param final nonzero if no more text will be appended to @a json
+ *
+ * @returns pointer within @a json to the selected value
+ * @retval NULL [EAGAIN] More text is needed to continue the selection.
+ * @retval NULL [ENOENT] The path was not found in the value.
+ * @retval NULL [EINVAL] The path or the JSON text is malformed.
+ * @retval NULL [ENOMEM] The input is too deeply nested.
+ */
+static const __JSON char *
+select_partial(struct json_selector *sel, const __JSON char *json, int final)
+{
+	struct path_component pc;
+	const __JSON char *p;
+	const __JSON char *q;
+
+	if (!json)
+		goto enoent;
+
+	for (;;) {
+		p = json + sel->offset;
+		switch (sel->state) {
+		case AT_VALUE:
+			if (!*sel->path) {
+				if (final) {
+					errno = 0;
+					return p;
+				}
+				/* A value is only known to be complete
+				 * once some text follows it */
+				q = p;
+				skip_white(&q);
+				if (!*q)
+					goto eagain;
+				switch (skip_partial(sel, json, q, final)) {
+				case 0:
+					goto eagain;
+				case -1:
+					return NULL;
+				}
+				/* A word ends at a delimiter; anything
+				 * else must be followed by more text */
+				if (!is_word_start(*q) && !*after_skip(sel, json))
+					goto eagain;
+				errno = 0;
+				return p;
+			}
+			if (!next_path_component(&sel->path, sel->first,
+			    NULL, &pc))
+				return NULL; /* EINVAL */
+			sel->first = 0;
+			sel->key = pc.key;
+			sel->keylen = pc.keylen;
+			sel->index = pc.index;
+			sel->state = pc.key ? AT_OBJECT : AT_ARRAY;
+			break;
+		case AT_ARRAY:
+		case AT_OBJECT:
+			q = p;
+			skip_white(&q);
+			if (!*q)
+				goto more;
+			if (!can_skip_char(&q,
+			    sel->state == AT_ARRAY ? '[' : '{'))
+				goto enoent;
+			sel->offset = q - json;
+			sel->state = sel->state == AT_ARRAY
+			    ? IN_ARRAY : IN_OBJECT;
+			break;
+		case IN_ARRAY:
+			/* Whitespace may have arrived since the offset
+			 * was last advanced */
+			skip_white(&p);
+			sel->offset = p - json;
+			if (!*p)
+				goto more;
+			if (*p == ']')
+				goto enoent;
+			if (!sel->index) {
+				sel->state = AT_VALUE;
+				break;
+			}
+			switch (skip_partial(sel, json, p, final)) {
+			case 0:
+				goto eagain;
+			case -1:
+				return NULL;
+			}
+			q = after_skip(sel, json);
+			if (!*q && !final)
+				goto eagain;
+			(void) can_skip_char(&q, ',');
+			sel->index--;
+			sel->offset = q - json;
+			sel->skip = SKIP_NONE;
+			break;
+		case IN_OBJECT:
+			/* Whitespace may have arrived since the offset
+			 * was last advanced */
+			skip_white(&p);
+			sel->offset = p - json;
+			if (!*p)
+				goto more;
+			if (*p == '}')
+				goto enoent;
+			if (!sel->value) {
+				/* Skip the key, then compare it */
+				switch (skip_partial(sel, json, p, final)) {
+				case 0:
+					goto eagain;
+				case -1:
+					return NULL;
+				}
+				q = after_skip(sel, json);
+				if (!*q && !final)
+					goto eagain;
+				(void) can_skip_char(&q, ':');
+				if (!*q)
+					goto more;
+				sel->skip = SKIP_NONE;
+				if (json_strcmpn(p, sel->key, sel->keylen) == 0) {
+					sel->offset = q - json;
+					sel->state = AT_VALUE;
+					break;
+				}
+				sel->value = q - json;
+			}
+			/* Skip the value of an unwanted member */
+			switch (skip_partial(sel, json, json + sel->value,
+			    final)) {
+			case 0:
+				goto eagain;
+			case -1:
+				return NULL;
+			}
+			q = after_skip(sel, json);
+			if (!*q && !final)
+				goto eagain;
+			(void) can_skip_char(&q, ',');
+			sel->offset = q - json;
+			sel->value = 0;
+			sel->skip = SKIP_NONE;
+			break;
+		}
+	}
+more:
+	if (final)
+		goto enoent;
+eagain:
+	errno = EAGAIN;
+	return NULL;
+enoent:
+	errno = ENOENT;
+	return NULL;
+}
+
+__PUBLIC
+const __JSON char *
+json_selector_resume(struct json_selector *sel, const __JSON char *json)
+{
+	return select_partial(sel, json, 0);
+}
+
+__PUBLIC
+const __JSON char *
+json_selector_finish(struct json_selector *sel, const __JSON char *json)
+{
+	return select_partial(sel, json, 1);
+}
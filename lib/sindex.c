@@ -0,0 +1,297 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "private.h"
+#include "utf8.h"
+
+/**
+ * Decodes the next code point of a JSON string or word.
+ *
+ * @param json_ptr  pointer into the content of a key. It is advanced.
+ * @param quote     the key's quote character, or 0 for a word
+ *
+ * @returns the decoded code point
+ * @retval 0 The end of the key was reached.
+ */
+static ucode
+next_key_char(const __JSON char **json_ptr, char quote)
+{
+	if (quote) {
+		if (!**json_ptr || **json_ptr == quote)
+			return 0;
+		return get_escaped_sanitized(json_ptr);
+	}
+	if (!is_word_char(**json_ptr))
+		return 0;
+	return get_utf8_sanitized(json_ptr);
+}
+
+/** Returns the quote of a JSON key, and advances over it. */
+static char
+key_quote(const __JSON char **json_ptr)
+{
+	char quote = **json_ptr;
+
+	if (quote != '"' && quote != '\'')
+		return 0;
+	++*json_ptr;
+	return quote;
+}
+
+/**
+ * Compares two JSON keys by their decoded code points.
+ *
+ * @retval <0 Key @a a sorts before key @a b.
+ * @retval 0  The keys are equal.
+ * @retval >0 Key @a a sorts after key @a b.
+ */
+static int
+key_cmp(const __JSON char *a, const __JSON char *b)
+{
+	char aq = key_quote(&a);
+	char bq = key_quote(&b);
+
+	for (;;) {
+		ucode au = next_key_char(&a, aq);
+		ucode bu = next_key_char(&b, bq);
+		if (au != bu)
+			return au < bu ? -1 : 1;
+		if (!au)
+			return 0;
+	}
+}
+
+/**
+ * Compares a JSON key with a UTF-8 string, or a prefix of it.
+ *
+ * @param json    JSON key
+ * @param str     a UTF-8 string, which need not be NUL-terminated
+ * @param len     the length of @a str
+ * @param prefix  nonzero if keys that begin with @a str compare equal
+ *
+ * @retval <0 The key sorts before @a str.
+ * @retval 0  The key is equal to @a str, or begins with it.
+ * @retval >0 The key sorts after @a str.
+ */
+int
+key_strcmp(const __JSON char *json, const char *str, size_t len, int prefix)
+{
+	const char *str_end = str + len;
+	char quote = key_quote(&json);
+
+	for (;;) {
+		ucode ju, su = 0;
+		if (str < str_end) {
+			size_t n = get_utf8_raw_bounded(str, str_end, &su);
+			if (!n)
+				return 1; /* Broken strings sort low */
+			str += n;
+		} else if (prefix)
+			return 0;
+		ju = next_key_char(&json, quote);
+		if (ju != su)
+			return ju < su ? -1 : 1;
+		if (!ju)
+			return 0;
+	}
+}
+
+/** Compares members i and j of the index, breaking ties by position */
+static int
+member_cmp(const __JSON char *object, const uint32_t *offsets,
+	size_t i, size_t j)
+{
+	int cmp = key_cmp(object + offsets[2 * i], object + offsets[2 * j]);
+
+	if (cmp)
+		return cmp;
+	return offsets[2 * i] < offsets[2 * j] ? -1 :
+	       offsets[2 * i] > offsets[2 * j];
+}
+
+/** Sifts member i down the heap of the first n members */
+static void
+sift_down(const __JSON char *object, uint32_t *offsets, size_t i, size_t n)
+{
+	for (;;) {
+		size_t child = 2 * i + 1;
+		uint32_t t;
+
+		if (child >= n)
+			return;
+		if (child + 1 < n &&
+		    member_cmp(object, offsets, child, child + 1) < 0)
+			child++;
+		if (member_cmp(object, offsets, i, child) >= 0)
+			return;
+		t = offsets[2 * i];
+		offsets[2 * i] = offsets[2 * child];
+		offsets[2 * child] = t;
+		t = offsets[2 * i + 1];
+		offsets[2 * i + 1] = offsets[2 * child + 1];
+		offsets[2 * child + 1] = t;
+		i = child;
+	}
+}
+
+/**
+ * Heap-sorts the members of the index by key.
+ *
+ * The C library's qsort() cannot be used, because the comparison
+ * needs the object text that the offsets refer to.
+ *
+ * @param object   the text that the offsets are relative to
+ * @param offsets  pairs of key and value offsets
+ * @param n        the number of pairs
+ */
+void
+sort_members(const __JSON char *object, uint32_t *offsets, size_t n)
+{
+	size_t i;
+
+	for (i = n / 2; i-- > 0; )
+		sift_down(object, offsets, i, n);
+	while (n-- > 1) {
+		uint32_t t;
+		t = offsets[0];
+		offsets[0] = offsets[2 * n];
+		offsets[2 * n] = t;
+		t = offsets[1];
+		offsets[1] = offsets[2 * n + 1];
+		offsets[2 * n + 1] = t;
+		sift_down(object, offsets, 0, n);
+	}
+}
+
+/**
+ * Finds the first member whose key is not below a string.
+ *
+ * @param idx     the sorted index
+ * @param str     the UTF-8 string to compare with
+ * @param prefix  how to compare, see #key_strcmp()
+ * @param upper   if nonzero, instead finds the first member above @a str
+ *
+ * @returns the position of the member, or @c idx->count
+ */
+static size_t
+search(const struct json_sorted_index *idx, const char *str, int prefix,
+	int upper)
+{
+	size_t lo = 0, hi = idx->count;
+	size_t len = strlen(str);
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		int cmp = key_strcmp(idx->object + idx->offsets[2 * mid],
+		    str, len, prefix);
+		if (cmp < 0 || (upper && cmp == 0))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+__PUBLIC
+int
+json_object_sorted_index(const __JSON char *json,
+	struct json_sorted_index *idx)
+{
+	const __JSON_OBJECTI char *ji;
+	const __JSON char *key;
+	const __JSON char *value;
+	long size;
+	size_t n = 0;
+
+	memset(idx, 0, sizeof *idx);
+	size = json_object_size(json);
+	if (size < 0)
+		return -1;
+	/* Allocate once, using the size counted beforehand */
+	idx->offsets = big_alloc((size ? size : 1) * 2 *
+	    sizeof *idx->offsets);
+	if (!idx->offsets)
+		return -1;
+
+	skip_white(&json);
+	ji = json_as_object(json);
+	errno = 0;
+	while ((value = json_object_next(&ji, &key))) {
+		if (n == (size_t)size)
+			goto invalid;
+		if ((size_t)(value - json) > UINT32_MAX) {
+			errno = EOVERFLOW;
+			goto fail;
+		}
+		idx->offsets[2 * n] = key - json;
+		idx->offsets[2 * n + 1] = value - json;
+		n++;
+	}
+	if (!ji)
+		goto invalid;
+
+	sort_members(json, idx->offsets, n);
+	idx->object = json;
+	idx->count = n;
+	return 0;
+invalid:
+	errno = EINVAL;
+fail:
+	big_free(idx->offsets);
+	idx->offsets = NULL;
+	return -1;
+}
+
+__PUBLIC
+void
+json_sorted_index_free(struct json_sorted_index *idx)
+{
+	big_free(idx->offsets);
+	idx->offsets = NULL;
+	idx->count = 0;
+}
+
+__PUBLIC
+const __JSON char *
+json_sorted_index_get(const struct json_sorted_index *idx, const char *key)
+{
+	size_t i = search(idx, key, 0, 0);
+
+	if (i == idx->count ||
+	    key_strcmp(idx->object + idx->offsets[2 * i], key, strlen(key),
+	    0) != 0)
+	{
+		errno = ENOENT;
+		return NULL;
+	}
+	return idx->object + idx->offsets[2 * i + 1];
+}
+
+__PUBLIC
+size_t
+json_sorted_index_prefix(const struct json_sorted_index *idx,
+	const char *prefix, size_t *first_return)
+{
+	size_t first = search(idx, prefix, 1, 0);
+	size_t end = search(idx, prefix, 1, 1);
+
+	if (first_return)
+		*first_return = first;
+	return end - first;
+}
+
+__PUBLIC
+const __JSON char *
+json_sorted_index_key(const struct json_sorted_index *idx, size_t i)
+{
+	return idx->object + idx->offsets[2 * i];
+}
+
+__PUBLIC
+const __JSON char *
+json_sorted_index_value(const struct json_sorted_index *idx, size_t i)
+{
+	return idx->object + idx->offsets[2 * i + 1];
+}
@@ -49,13 +49,15 @@ can_skip_char(const __JSON char **json_ptr, char ch)
  * However, it will <em>not</em> skip structural characters [] {} : ,
  *
  * @param json_ptr  pointer to (optional) JSON text
+ * @param padded    nonzero if #JSON_PADDING bytes after the text's NUL
+ *                  terminator are readable
  *
  * @retval 0 No skipping occurred.
  * @retval nonzero An unquoted word or quoted string and its trailing
  *                 whitespace was skipped.
  */
 static int
-skip_word_or_string(const __JSON char **json_ptr)
+skip_word_or_string(const __JSON char **json_ptr, int padded)
 {
 	const __JSON char *json;
 
@@ -66,11 +68,24 @@ skip_word_or_string(const __JSON char **json_ptr)
 
 	if (*json == '"' || *json == '\'') {
 		__JSON char quote = *json++;
+		const char stop[4] = { quote, '\\', 0, 0 };
 		__JSON char ch;
-		while ((ch = *json++)) {
+		size_t steps = 0;
+		while ((ch = *json)) {
+			/* Short strings are done sooner a byte at a
+			 * time. In longer ones, only the quote,
+			 * backslash and NUL end the kernel's run, so
+			 * its reads stay within the padding; the stop
+			 * byte is then stepped over below. */
+			if (padded && ++steps > 16) {
+				json += byte_span(json, JSON_PADDING, stop);
+				if (!(ch = *json))
+					break;
+			}
+			json++;
 			if (ch == quote)
 				break;
-			if (ch == '\\')
+			if (ch == '\\' && *json)
 				json++;
 		}
 	}
@@ -95,13 +110,15 @@ skip_word_or_string(const __JSON char **json_ptr)
  * objects up to a depth of 32768.
  *
  * @param json_ptr  pointer to (optional) JSON text (not whitespace!)
+ * @param padded    nonzero if #JSON_PADDING bytes after the text's NUL
+ *                  terminator are readable
  *
  * @retval nonzero A value was skipped.
  * @retval 0 [EINVAL] Nothing was skipped.
  * @retval 0 [ENOMEM] The nesting depth limit was reached.
  */
-int
-skip_value(const __JSON char **json_ptr)
+static int
+skip_any_value(const __JSON char **json_ptr, int padded)
 {
 	/* Avoid recursion by using a nesting stack that remembers
 	 * whether an array or object was entered (1=array) */
@@ -148,7 +165,7 @@ skip_value(const __JSON char **json_ptr)
 
 		if (depth.bit && !(nest[depth.offset] & depth.bit)) {
 			/* We're in an object; expect a key and colon */
-			(void) skip_word_or_string(&json);
+			(void) skip_word_or_string(&json, padded);
 			(void) can_skip_char(&json, ':');
 		}
 
@@ -176,7 +193,9 @@ skip_value(const __JSON char **json_ptr)
 			json++;
 			skip_white(&json);
 		} else {
-			skip_word_or_string(&json);
+			if (!skip_word_or_string(&json, padded) && depth.bit &&
+			    *json != ',' && *json != ']' && *json != '}')
+				goto done; /* stuck at ':' or a control char */
 			if (!depth.bit)
 				goto done; /* completed */
 		}
@@ -194,3 +213,22 @@ done:
 	return 1;
 }
 
+/**
+ * Skips over a JSON value and its trailing whitespace.
+ * @see #skip_any_value()
+ */
+int
+skip_value(const __JSON char **json_ptr)
+{
+	return skip_any_value(json_ptr, 0);
+}
+
+/**
+ * Skips over a JSON value in padded input, and its trailing whitespace.
+ * @see #skip_any_value()
+ */
+int
+skip_value_padded(const __JSON char **json_ptr)
+{
+	return skip_any_value(json_ptr, 1);
+}
@@ -11,3 +11,15 @@ json_span(const __JSON char *json)
 		return 0;
 	return json - json_start;
 }
+
+__PUBLIC
+size_t
+json_span_padded(const __JSON char *json)
+{
+	const __JSON char *json_start = json;
+
+	skip_white(&json);
+	if (skip_value_padded(&json) == 0)
+		return 0;
+	return json - json_start;
+}
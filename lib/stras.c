@@ -7,6 +7,7 @@
 #include "utf8.h"
 
 #define SAFE 1
+#define PADDED 2
 
 /** Converts a hexadecimal ASCII digit into its integer value. */
 static unsigned
@@ -140,6 +141,8 @@ get_escaped_sanitized(const __JSON char **json_ptr)
  * @param bufsz (optional) size of the output buffer
  * @param flags <ul>
  *              <li>#SAFE: don't allow the output to contain invalid UTF-8
+ *              <li>#PADDED: the input is followed by #JSON_PADDING
+ *                  readable bytes after its NUL terminator
  *              </ul>
  *
  * @returns the number of bytes stored in the output buffer (including
@@ -173,6 +176,24 @@ as_str(const __JSON char *json, void *buf, size_t bufsz, int flags)
 
 	while (*json && (quote ? (*json != quote) : is_word_char(*json))) {
 		__SANITIZED ucode u;
+		const __JSON char *run;
+
+		/* Copy runs of valid UTF-8 without decoding them */
+		if (quote)
+			run = json + span_utf8(json, NULL,
+			    quote == '"' ? "\"\\" : "'\\", flags & PADDED);
+		else
+			run = json;
+		if (run != json) {
+			size_t runlen = run - json;
+			if (bufsz > n)
+				memcpy(out + n, json,
+				    runlen < bufsz - n ? runlen : bufsz - n);
+			n += runlen;
+			json = run;
+			continue;
+		}
+
 		if (quote)
 			u = get_escaped_sanitized(&json);
 		else
@@ -228,6 +249,89 @@ as_str_alloc(const __JSON char *json, int flags)
 	return buf;
 }
 
+__PUBLIC
+int
+json_as_str_array(const __JSON char *json, struct json_str_array *out)
+{
+	const __JSON_ARRAYI char *ji;
+	const __JSON char *elem;
+	char *data;
+	size_t *offsets;
+	size_t datasz;
+	size_t offsetsz = 16;
+	size_t used = 0;
+	size_t count = 0;
+	int save_errno = errno;
+
+	ji = json_as_array(json);
+	if (!ji)
+		return -1;
+
+	/* The decoded strings are never longer than the array text,
+	 * so a single allocation is almost always enough. */
+	datasz = json_span(json);
+	data = big_alloc(datasz ? datasz : 1);
+	offsets = big_alloc(offsetsz * sizeof *offsets);
+	if (!data || !offsets)
+		goto fail;
+
+	while ((elem = json_array_next(&ji))) {
+		size_t n;
+
+		if (count + 1 == offsetsz) {
+			size_t *new_offsets;
+			offsetsz *= 2;
+			new_offsets = big_realloc(offsets,
+			    offsetsz * sizeof *offsets);
+			if (!new_offsets)
+				goto fail;
+			offsets = new_offsets;
+		}
+		n = as_str(elem, data + used, datasz - used, SAFE);
+		if (n > datasz - used || (!n && errno == ENOMEM)) {
+			char *new_data;
+			if (!n)
+				n = as_str(elem, NULL, 0, SAFE);
+			datasz = datasz * 2 > used + n ? datasz * 2 : used + n;
+			new_data = big_realloc(data, datasz);
+			if (!new_data)
+				goto fail;
+			data = new_data;
+			n = as_str(elem, data + used, datasz - used, SAFE);
+		}
+		if (!n)
+			goto fail; /* EINVAL */
+		offsets[count++] = used;
+		used += n;
+	}
+	if (!ji) {
+		errno = EINVAL; /* malformed array */
+		goto fail;
+	}
+	offsets[count] = used;
+
+	out->data = data;
+	out->offsets = offsets;
+	out->count = count;
+	errno = save_errno;
+	return 0;
+fail:
+	big_free(data);
+	big_free(offsets);
+	return -1;
+}
+
+__PUBLIC
+void
+json_str_array_free(struct json_str_array *a)
+{
+	big_free(a->data);
+	big_free(a->offsets);
+	a->data = NULL;
+	a->offsets = NULL;
+	a->count = 0;
+}
+
 __PUBLIC
 size_t
 json_as_utf8b(const __JSON char *json, void *buf, size_t bufsz)
@@ -242,6 +346,13 @@ json_as_str(const __JSON char *json, void *buf, size_t bufsz)
 	return as_str(json, buf, bufsz, SAFE);
 }
 
+__PUBLIC
+size_t
+json_as_str_padded(const __JSON char *json, void *buf, size_t bufsz)
+{
+	return as_str(json, buf, bufsz, SAFE | PADDED);
+}
+
 __PUBLIC
 char *
 json_as_utf8b_strdup(const __JSON char *json)
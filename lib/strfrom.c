@@ -116,6 +116,23 @@ string_from_strn(const char *src, int srclen,
 		ucode u;
 		size_t n;
 
+		/* Copy runs of valid UTF-8 that need no escaping. The
+		 * characters that "</" and "]]>" guard against end a run */
+		n = span_utf8(src, src_end, "\"\\/>", 0);
+		if (n) {
+			size_t room = out < out_end ? out_end - out : 0;
+			if (room) {
+				memcpy(out, src, n < room ? n : room);
+				out += n < room ? n : room;
+			}
+			outlen += n;
+			lookbehind[0] = n > 1 ? (unsigned char)src[n - 2]
+					      : lookbehind[1];
+			lookbehind[1] = (unsigned char)src[n - 1];
+			src += n;
+			continue;
+		}
+
 		n = get_utf8_raw_bounded(src, src_end, &u);
 		if (n == 0) {
 			errno = EINVAL; /* Bad UTF-8 in source string */
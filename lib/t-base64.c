@@ -73,6 +73,9 @@ main()
 {
 
 	char plain[1024];
+	char bytes[100];
+	char json[JSON_FROM_BYTES_DSTSZ(100) + JSON_FROM_HEX_DSTSZ(100)];
+	int i, n;
 
 	/* The JSON_FROM_BYTES_DSTSZ() macro computes the right size.
 	 * Using the examples from RFC 3548 section 7 and adding
@@ -152,5 +155,59 @@ main()
 	assert_decodes_as_invalid("\xc0\x80");
 	assert_decodes_as_invalid("\xf0\x9f\x80\x9c");
 
+	/* Hexadecimal encodes to lowercase and decodes either case */
+	assert_inteq(JSON_FROM_HEX_DSTSZ(4), 8 + 3);
+	assert_inteq(json_from_hex("\x01\xab\xcd\xef", 4, plain, 11), 10);
+	assert_streq(plain, "\"01abcdef\"");
+	assert_inteq(json_as_hex("\"01abCDef\"", plain, sizeof plain), 4);
+	assert_memeq(plain, "\x01\xab\xcd\xef", 4);
+	assert_inteq(json_from_hex("", 0, plain, 3), 2);
+	assert_streq(plain, "\"\"");
+	assert_inteq(json_as_hex(" '' ", plain, sizeof plain), 0);
+
+	/* A SHA-256 digest round-trips through hexadecimal */
+	assert_inteq(json_as_hex("\"e3b0c44298fc1c149afbf4c8996fb924"
+	    "27ae41e4649b934ca495991b7852b855\"", plain, sizeof plain), 32);
+	assert_memeq(plain, "\xe3\xb0\xc4\x42\x98\xfc\x1c\x14"
+	    "\x9a\xfb\xf4\xc8\x99\x6f\xb9\x24\x27\xae\x41\xe4"
+	    "\x64\x9b\x93\x4c\xa4\x95\x99\x1b\x78\x52\xb8\x55", 32);
+	assert_inteq(json_from_hex(plain, 32, plain + 32, JSON_FROM_HEX_DSTSZ(32)),
+	    66);
+	assert_streq(plain + 32, "\"e3b0c44298fc1c149afbf4c8996fb924"
+	    "27ae41e4649b934ca495991b7852b855\"");
+
+	/* Every length round-trips, across the vector widths */
+	for (n = 0; n <= 100; n++) {
+		for (i = 0; i < n; i++)
+			bytes[i] = i * 37 + n;
+		assert_inteq(json_from_bytes(bytes, n, json, sizeof json),
+		    (n + 2) / 3 * 4 + 2);
+		assert_inteq(json_as_bytes(json, plain, sizeof plain), n);
+		assert_memeq(plain, bytes, n);
+		assert_inteq(json_from_hex(bytes, n, json, sizeof json),
+		    2 * n + 2);
+		assert_inteq(json_as_hex(json, plain, sizeof plain), n);
+		assert_memeq(plain, bytes, n);
+	}
+
+	/* A zero-sized buffer requests the decoded size */
+	assert_inteq(json_as_hex("\"00112233445566778899\"", NULL, 0), 10);
+
+	/* Small buffers are an error */
+	assert_errno(json_as_hex("\"0011\"", plain, 1) == -1, ENOMEM);
+	assert_errno(json_from_hex("\x01", 1, plain, 4) == -1, ENOMEM);
+
+	/* Invalid hexadecimal strings are rejected */
+	assert_errno(json_as_hex(NULL, plain, sizeof plain) == -1, EINVAL);
+	assert_errno(json_as_hex("0011", plain, sizeof plain) == -1, EINVAL);
+	assert_errno(json_as_hex("\"001\"", plain, sizeof plain) == -1, EINVAL);
+	assert_errno(json_as_hex("\"00 11\"", plain, sizeof plain) == -1,
+	    EINVAL);
+	assert_errno(json_as_hex("\"0123456g\"", plain, sizeof plain) == -1,
+	    EINVAL);
+	assert_errno(json_as_hex("\"\\u0030\\u0030\"", plain, sizeof plain)
+	    == -1, EINVAL);
+	assert_errno(json_as_hex("\"0011", plain, sizeof plain) == -1, EINVAL);
+
 	return 0;
 }
@@ -0,0 +1,90 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+#define NMEMBERS 300000	/* enough for 2.4 MB of index offsets */
+
+int
+main()
+{
+	static const unsigned policies[] = {
+		0,
+		JSON_ALLOC_HUGE_PAGES,
+		JSON_ALLOC_HUGETLB,
+		JSON_ALLOC_LOCAL,
+		JSON_ALLOC_HUGE_PAGES | JSON_ALLOC_HUGETLB | JSON_ALLOC_LOCAL,
+	};
+	char *object, *array;
+	size_t len, i, p;
+	char key[32];
+
+	/* Large documents, whose indexes use the large allocations */
+	object = malloc(NMEMBERS * 24 + 3);
+	array = malloc(NMEMBERS * 12 + 3);
+	assert(object && array);
+	len = 0;
+	object[len++] = '{';
+	for (i = 0; i < NMEMBERS; i++)
+		len += sprintf(object + len, "\"k%zu\":%zu,", i, i);
+	strcpy(object + len - 1, "}");
+	len = 0;
+	array[len++] = '[';
+	for (i = 0; i < NMEMBERS; i++)
+		len += sprintf(array + len, "\"s%zu\",", i);
+	strcpy(array + len - 1, "]");
+
+	/* The policy is returned when it is replaced */
+	assert_inteq(json_set_alloc_policy(JSON_ALLOC_LOCAL), 0);
+	assert_inteq(json_set_alloc_policy(0xff), JSON_ALLOC_LOCAL);
+	assert_inteq(json_set_alloc_policy(0), JSON_ALLOC_HUGE_PAGES |
+	    JSON_ALLOC_HUGETLB | JSON_ALLOC_LOCAL);
+
+	/* Every policy gives the same results, whatever the system
+	 * provides. Policies change how memory is mapped, not what
+	 * is stored in it. */
+	for (p = 0; p < sizeof policies / sizeof policies[0]; p++) {
+		struct json_str_array a;
+		struct json_intern *t;
+
+		json_set_alloc_policy(policies[p]);
+
+		assert_inteq(json_as_str_array(array, &a), 0);
+		assert_inteq(a.count, NMEMBERS);
+		assert_streq(a.data + a.offsets[NMEMBERS - 1], "s299999");
+		json_str_array_free(&a);
+
+		t = json_intern_new();
+		assert(t);
+		for (i = 0; i < NMEMBERS / 2; i++) {
+			snprintf(key, sizeof key, "k%zu", i);
+			assert_inteq(json_intern_add(t, key), i);
+		}
+		assert_inteq(json_intern_lookup(t, "k12345"), 12345);
+		json_intern_free(t);
+	}
+
+	/* Sorting a large index is slow, so it is only built once,
+	 * with every policy flag */
+	{
+		struct json_sorted_index idx;
+
+		assert_inteq(json_object_sorted_index(object, &idx), 0);
+		assert_inteq(idx.count, NMEMBERS);
+		for (i = 0; i < NMEMBERS; i += 9973) {
+			snprintf(key, sizeof key, "k%zu", i);
+			assert_inteq(json_as_long(json_sorted_index_get(&idx,
+			    key)), i);
+		}
+		json_sorted_index_free(&idx);
+	}
+	json_set_alloc_policy(0);
+
+	free(object);
+	free(array);
+	return 0;
+}
@@ -0,0 +1,61 @@
+#include <errno.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+/** Counts array elements the slow way, with json_array_next() */
+static long
+iterate_length(const char *json)
+{
+	const char *ji = json_as_array(json);
+	long n = 0;
+
+	while (json_array_next(&ji))
+		n++;
+	return n;
+}
+
+int
+main()
+{
+	/* Happy path: counting array elements */
+	assert_inteq_errno(json_array_length("[1, \"two\", [3, 4], {\"5\": 6}]"),
+	    4, 0);
+	assert_inteq_errno(json_array_length(" [ 1 ] "), 1, 0);
+	assert_inteq_errno(json_array_length("[]"), 0, 0);
+	assert_inteq_errno(json_array_length(" [ \n ] "), 0, 0);
+
+	/* Happy path: counting object members */
+	assert_inteq_errno(json_object_size("{\"a\": 1, \"b\": [1,2], \"c\": {}}"),
+	    3, 0);
+	assert_inteq_errno(json_object_size("{}"), 0, 0);
+
+	/* Commas inside strings and nested structures are not counted */
+	assert_inteq(json_array_length("[\",\", \"\\\",\", ',', [,], {\"a,\":1}]"),
+	    5);
+	assert_inteq(json_object_size("{\"a,b\": \"[,\", \"c\": '}'}"), 2);
+
+	/* Single quotes inside words are word characters */
+	assert_inteq(json_array_length("[don't, \"x\", won''t]"), 3);
+
+	/* Trailing commas are accepted, as json_array_next() accepts them */
+	assert_inteq(json_array_length("[1, 2, ]"), 2);
+	assert_inteq(iterate_length("[1, 2, ]"), 2);
+	assert_inteq(json_object_size("{\"a\":1,}"), 1);
+
+	/* Counts agree with iteration */
+	assert_inteq(json_array_length("[[[]],{},\"\",null,-1e3,[{}]]"),
+	    iterate_length("[[[]],{},\"\",null,-1e3,[{}]]"));
+
+	/* Non-containers and unterminated containers are invalid */
+	assert_inteq_errno(json_array_length(NULL), -1, EINVAL);
+	assert_inteq_errno(json_array_length("{}"), -1, EINVAL);
+	assert_inteq_errno(json_object_size("[]"), -1, EINVAL);
+	assert_inteq_errno(json_array_length("[1, 2"), -1, EINVAL);
+	assert_inteq_errno(json_array_length("[1, \"2]"), -1, EINVAL);
+	assert_inteq_errno(json_array_length("[1, [2]"), -1, EINVAL);
+	assert_inteq_errno(json_array_length("[1, 2}"), -1, EINVAL);
+
+	return 0;
+}
@@ -0,0 +1,54 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+int
+main()
+{
+	const char *env = getenv("REDJSON_CPU");
+	unsigned features = json_cpu_features();
+	char src[200];
+	char buf[512];
+	size_t i;
+
+	/* The environment can only lower the variant in use */
+	if (env && (strcmp(env, "scalar") == 0 || strcmp(env, "swar") == 0))
+		assert_inteq(features, 0);
+	if (env && strcmp(env, "sse2") == 0)
+		assert(!(features & ~JSON_CPU_SSE2));
+	if (env && strcmp(env, "avx2") == 0)
+		assert(!(features & JSON_CPU_AVX512));
+	assert_inteq(json_cpu_features(), features);
+
+	/* Long runs end at a character to escape in every position,
+	 * so that the kernels end their runs inside and between vectors */
+	memset(src, 'a', sizeof src);
+	for (i = 0; i < sizeof src; i++) {
+		src[i] = '"';
+		assert_inteq(json_from_strn(src, sizeof src, buf, sizeof buf),
+		    sizeof src + 4);
+		assert(buf[i + 1] == '\\' && buf[i + 2] == '"');
+		assert(buf[i] == (i ? 'a' : '"'));
+		src[i] = '\n';
+		assert_inteq(json_from_strn(src, sizeof src, buf, sizeof buf),
+		    sizeof src + 4);
+		assert(buf[i + 1] == '\\' && buf[i + 2] == 'n');
+		src[i] = '\x80';
+		assert_errno(json_from_strn(src, sizeof src, buf,
+		    sizeof buf) == 0, EINVAL);
+
+		/* Latin-1 transcoding copies the ASCII either side */
+		src[i] = '\xe9';
+		assert_inteq(json_transcode(JSON_ENCODING_LATIN1, src,
+		    sizeof src, buf, sizeof buf), sizeof src + 2);
+		assert(buf[i] == '\xc3' && buf[i + 1] == '\xa9');
+		assert(buf[sizeof src] == (i + 1 < sizeof src ? 'a' : '\xa9'));
+		src[i] = 'a';
+	}
+
+	return 0;
+}
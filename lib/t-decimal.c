@@ -0,0 +1,119 @@
+#include <errno.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+int
+main()
+{
+	char buf[JSON_FROM_DECIMAL64_SZ];
+	struct json_decimal128 d;
+
+	/* Happy path: money amounts convert exactly to cents */
+	assert_errno(json_as_decimal64("12.34", 2) == 1234, 0);
+	assert_errno(json_as_decimal64("-0.05", 2) == -5, 0);
+	assert_errno(json_as_decimal64("7", 2) == 700, 0);
+	assert_errno(json_as_decimal64(" 1.5e1 ", 2) == 1500, 0);
+	assert_errno(json_as_decimal64("125e-2", 2) == 125, 0);
+	assert_errno(json_as_decimal64("0.10", 1) == 1, 0);
+	assert_errno(json_as_decimal64("0", 18) == 0, 0);
+	assert_errno(json_as_decimal64("0e999999999", 0) == 0, 0);
+
+	/* The full int64_t range is available */
+	assert_errno(json_as_decimal64("9223372036854775807", 0) == INT64_MAX,
+	    0);
+	assert_errno(json_as_decimal64("-9.223372036854775808", 18)
+	    == INT64_MIN, 0);
+
+	/* Too many decimal places truncate towards zero with ERANGE */
+	assert_errno(json_as_decimal64("1.239", 2) == 123, ERANGE);
+	assert_errno(json_as_decimal64("-1.239", 2) == -123, ERANGE);
+	assert_errno(json_as_decimal64("1e-9", 2) == 0, ERANGE);
+
+	/* Numbers too large for the scale clamp with ERANGE */
+	assert_errno(json_as_decimal64("9223372036854775808", 0) == INT64_MAX,
+	    ERANGE);
+	assert_errno(json_as_decimal64("-1e17", 2) == INT64_MIN, ERANGE);
+
+	/* Quoted numbers convert, but are not strict JSON numbers */
+	assert_errno(json_as_decimal64("\"12.30\"", 2) == 1230, EINVAL);
+
+	/* Non-numbers and bad scales are invalid */
+	assert_errno(json_as_decimal64(NULL, 2) == 0, EINVAL);
+	assert_errno(json_as_decimal64("null", 2) == 0, EINVAL);
+	assert_errno(json_as_decimal64("1.", 2) == 0, EINVAL);
+	assert_errno(json_as_decimal64("\"1x\"", 2) == 0, EINVAL);
+	assert_errno(json_as_decimal64("1", -1) == 0, EINVAL);
+	assert_errno(json_as_decimal64("1", 19) == 0, EINVAL);
+
+	/* Scaled integers convert back into JSON numbers */
+	assert_inteq(json_from_decimal64(1230, 2, buf, sizeof buf), 6);
+	assert_streq(buf, "12.30");
+	assert_inteq(json_from_decimal64(-5, 2, buf, sizeof buf), 6);
+	assert_streq(buf, "-0.05");
+	assert_inteq(json_from_decimal64(0, 0, buf, sizeof buf), 2);
+	assert_streq(buf, "0");
+	assert_inteq(json_from_decimal64(INT64_MIN, 18, buf, sizeof buf),
+	    sizeof buf);
+	assert_streq(buf, "-9.223372036854775808");
+	assert_inteq(json_from_decimal64(1, 18, buf, sizeof buf), 21);
+	assert_streq(buf, "0.000000000000000001");
+
+	/* A size request returns the size needed */
+	assert_inteq(json_from_decimal64(-5, 2, NULL, 0), 6);
+
+	/* A small buffer is an error */
+	assert_errno(json_from_decimal64(1230, 2, buf, 5) == 0, ENOMEM);
+	assert_streq(buf, "");
+	assert_errno(json_from_decimal64(1, 19, buf, sizeof buf) == 0, EINVAL);
+
+	/* Decimal floating-point keeps all digits and trailing zeros */
+	assert_inteq(json_as_decimal128("-1.50", &d), 0);
+	assert(d.negative);
+	assert_inteq(d.exponent, -2);
+	assert(d.hi == 0 && d.lo == 150);
+
+	/* A 34-digit coefficient is split at the 17th digit */
+	assert_inteq(json_as_decimal128(
+	    "1234567890123456789012345678901234e3", &d), 0);
+	assert(!d.negative);
+	assert_inteq(d.exponent, 3);
+	assert(d.hi == 12345678901234567ULL && d.lo == 89012345678901234ULL);
+
+	/* Leading zeros are not significant */
+	assert_inteq(json_as_decimal128("0.000000000000000000000000000000000001",
+	    &d), 0);
+	assert(d.hi == 0 && d.lo == 1);
+	assert_inteq(d.exponent, -36);
+
+	/* More than 34 significant digits truncate with ERANGE */
+	assert_errno(json_as_decimal128(
+	    "12345678901234567890123456789012345", &d) == -1, ERANGE);
+	assert_inteq(d.exponent, 1);
+	assert(d.hi == 12345678901234567ULL && d.lo == 89012345678901234ULL);
+
+	/* Exponents beyond the decimal128 range move into the
+	 * coefficient's trailing zeros, where they fit */
+	assert_inteq(json_as_decimal128("1e6112", &d), 0);
+	assert_inteq(d.exponent, 6111);
+	assert(d.hi == 0 && d.lo == 10);
+	assert_inteq(json_as_decimal128("-1e6144", &d), 0);
+	assert(d.negative);
+	assert_inteq(d.exponent, 6111);
+	assert(d.hi == 10000000000000000ULL && d.lo == 0);
+	assert_inteq(json_as_decimal128("1000e-6179", &d), 0);
+	assert_inteq(d.exponent, -6176);
+	assert(d.hi == 0 && d.lo == 1);
+
+	/* Otherwise they are an error */
+	assert_errno(json_as_decimal128("1e6145", &d) == -1, ERANGE);
+	assert_errno(json_as_decimal128("1e-6177", &d) == -1, ERANGE);
+	assert_errno(json_as_decimal128("1010e-6178", &d) == -1, ERANGE);
+	assert_errno(json_as_decimal128("0e-9999", &d) == 0, 0);
+
+	/* Non-numbers are invalid */
+	assert_errno(json_as_decimal128("true", &d) == -1, EINVAL);
+
+	return 0;
+}
@@ -0,0 +1,68 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+int
+main()
+{
+	struct json_key_filter f;
+	char big[4096];
+	char key[32];
+	int i, fp;
+
+	/* Happy path: present keys are found, absent keys are not */
+	assert_inteq(json_key_filter_init(&f,
+	    "{\"id\": 7, \"name\": \"x\", \"tags\": [1]}"), 0);
+	assert(json_key_filter_test(&f, "id"));
+	assert(json_key_filter_test(&f, "tags"));
+	assert_streq(json_key_filter_get(&f, "name"), "\"x\", \"tags\": [1]}");
+	assert_errno(json_key_filter_get(&f, "email") == NULL, ENOENT);
+	assert_errno(json_key_filter_get(&f, "") == NULL, ENOENT);
+
+	/* Success leaves errno alone */
+	errno = ERANGE;
+	assert_inteq(json_key_filter_init(&f, "{\"a\": 1}"), 0);
+	assert_inteq(errno, ERANGE);
+
+	/* Escaped keys are found by their decoded form */
+	assert_inteq(json_key_filter_init(&f,
+	    "{\"\\u00e9t\\u00e9\": 1, \"a\\/b\": 2, \"\\ud83d\\ude00\": 3}"), 0);
+	assert(json_key_filter_test(&f, "\xc3\xa9t\xc3\xa9"));
+	assert(json_key_filter_test(&f, "a/b"));
+	assert(json_key_filter_test(&f, "\xf0\x9f\x98\x80"));
+	assert_streq(json_key_filter_get(&f, "a/b"),
+	    "2, \"\\ud83d\\ude00\": 3}");
+
+	/* An empty object contains nothing */
+	assert_inteq(json_key_filter_init(&f, "{}"), 0);
+	assert(!json_key_filter_test(&f, "id"));
+	assert_errno(json_key_filter_get(&f, "id") == NULL, ENOENT);
+
+	/* No false negatives, and few false positives, for 50 keys */
+	strcpy(big, "{");
+	for (i = 0; i < 50; i++)
+		sprintf(big + strlen(big), "%s\"key%d\":%d", i ? "," : "", i, i);
+	strcat(big, "}");
+	assert_inteq(json_key_filter_init(&f, big), 0);
+	for (i = 0; i < 50; i++) {
+		sprintf(key, "key%d", i);
+		assert_inteq(json_as_int(json_key_filter_get(&f, key)), i);
+	}
+	for (fp = 0, i = 50; i < 10050; i++) {
+		sprintf(key, "key%d", i);
+		fp += json_key_filter_test(&f, key);
+	}
+	assert(fp < 400);
+
+	/* Non-objects and malformed objects are invalid */
+	assert_errno(json_key_filter_init(&f, NULL) == -1, EINVAL);
+	assert_errno(json_key_filter_init(&f, "[]") == -1, EINVAL);
+	assert_errno(json_key_filter_init(&f, "{\"a\":1") == -1, EINVAL);
+	assert_errno(json_key_filter_get(&f, "a") == NULL, ENOENT);
+
+	return 0;
+}
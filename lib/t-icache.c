@@ -0,0 +1,179 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+#define NDOCS		8
+#define NTHREADS	4
+#define NGETS		5000
+
+static char docs[NDOCS][256];
+static struct json_image_cache *shared;
+
+/* Fetches documents at random, and checks each image's content */
+static void *
+worker(void *arg)
+{
+	unsigned seed = (unsigned)(size_t)arg;
+	int i;
+
+	for (i = 0; i < NGETS; i++) {
+		int d = rand_r(&seed) % NDOCS;
+		const void *image = json_image_cache_get(shared, docs[d]);
+
+		assert(image);
+		assert(json_as_int(json_image_select(image, "id")) == d);
+		json_image_cache_release(shared, image);
+	}
+	return NULL;
+}
+
+int
+main()
+{
+	struct json_image_cache *c, *c2;
+	const void *a, *b, *a2;
+	char copy[256];
+	pthread_t threads[NTHREADS];
+	size_t one;
+	int i;
+
+	for (i = 0; i < NDOCS; i++)
+		snprintf(docs[i], sizeof docs[i],
+		    "{\"id\": %d, \"tags\": [\"x\", \"y\"], \"pad\": \"%*s\"}",
+		    i, 40 + i, "");
+
+	/* The same content finds the same image, even at another address */
+	c = json_image_cache_new(1 << 20);
+	assert(c);
+	assert_inteq(json_image_cache_size(c), 0);
+	a = json_image_cache_get(c, docs[0]);
+	assert(a);
+	one = json_image_cache_size(c);
+	assert(one > strlen(docs[0]));
+	strcpy(copy, docs[0]);
+	a2 = json_image_cache_get(c, copy);
+	assert(a2 == a);
+	assert_inteq(json_image_cache_size(c), one);
+	assert_inteq(json_as_int(json_image_select(a, "id")), 0);
+	assert_streq(json_image_select(a, "tags[1]"), "\"y\"], \"pad\": \""
+	    "                                        \"}");
+	json_image_cache_release(c, a);
+	json_image_cache_release(c, a2);
+
+	/* Different content has a different image */
+	copy[7] = '9';
+	b = json_image_cache_get(c, copy);
+	assert(b && b != a);
+	assert_inteq(json_as_int(json_image_select(b, "id")), 9);
+	json_image_cache_release(c, b);
+
+	/* Trailing whitespace is ignored; trailing text is not cached */
+	strcpy(copy, docs[0]);
+	strcat(copy, " \n");
+	a = json_image_cache_get(c, copy);
+	assert(a);
+	json_image_cache_release(c, a);
+	strcpy(copy, docs[0]);
+	strcat(copy, " 1");
+	b = json_image_cache_get(c, copy);
+	assert(b && b != a);
+	assert_inteq(json_as_int(json_image_select(b, "id")), 0);
+	a2 = json_image_cache_get(c, copy);
+	assert(a2 && a2 != b);
+	json_image_cache_release(c, a2);
+	json_image_cache_release(c, b);
+	a2 = json_image_cache_get(c, docs[0]);
+	assert(a2 == a);
+	json_image_cache_release(c, a2);
+
+	/* Text that ends in whitespace is cached, even the first time */
+	c2 = json_image_cache_new(1 << 20);
+	assert(c2);
+	strcpy(copy, docs[1]);
+	strcat(copy, "\n");
+	a = json_image_cache_get(c2, copy);
+	assert(a);
+	assert(json_image_cache_size(c2) > strlen(copy));
+	a2 = json_image_cache_get(c2, copy);
+	assert(a2 == a);
+	b = json_image_cache_get(c2, docs[1]);
+	assert(b == a);
+	json_image_cache_release(c2, b);
+	json_image_cache_release(c2, a2);
+	json_image_cache_release(c2, a);
+	json_image_cache_free(c2);
+
+	/* Malformed text has no image */
+	assert_errno(json_image_cache_get(c, "}") == NULL, EINVAL);
+	assert_errno(json_image_cache_get(c, NULL) == NULL, EINVAL);
+	json_image_cache_release(c, NULL);
+	json_image_cache_free(c);
+
+	/* Unused images are evicted to keep within the budget */
+	c = json_image_cache_new(3 * one);
+	assert(c);
+	for (i = 0; i < NDOCS; i++) {
+		a = json_image_cache_get(c, docs[i]);
+		assert_inteq(json_as_int(json_image_select(a, "id")), i);
+		json_image_cache_release(c, a);
+		assert(json_image_cache_size(c) <= 3 * one);
+	}
+	assert(json_image_cache_size(c) > 0);
+
+	json_image_cache_free(c);
+
+	/* Recently used images survive eviction. Any three documents
+	 * fit. Adding a fourth clears every mark and evicts one of the
+	 * first three, so each later addition finds an unmarked entry
+	 * to evict before the hand comes back to docs[3]. */
+	c = json_image_cache_new(3 * one + 3 * NDOCS);
+	assert(c);
+	for (i = 0; i < 4; i++)
+		json_image_cache_release(c, json_image_cache_get(c, docs[i]));
+	a = json_image_cache_get(c, docs[3]);
+	json_image_cache_release(c, a);
+	for (i = 4; i < 6; i++) {
+		b = json_image_cache_get(c, docs[i]);
+		json_image_cache_release(c, b);
+		a2 = json_image_cache_get(c, docs[3]);
+		assert(a2 == a);
+		json_image_cache_release(c, a2);
+	}
+	assert(json_image_cache_size(c) <= 3 * one + 3 * NDOCS);
+	json_image_cache_free(c);
+
+	/* Images in use are not evicted; those that do not fit are
+	 * returned uncached */
+	c = json_image_cache_new(one + one / 2);
+	assert(c);
+	a = json_image_cache_get(c, docs[0]);
+	b = json_image_cache_get(c, docs[1]);
+	assert(a && b);
+	assert_inteq(json_as_int(json_image_select(b, "id")), 1);
+	assert_inteq(json_image_cache_size(c), one);
+	a2 = json_image_cache_get(c, docs[0]);
+	assert(a2 == a);
+	json_image_cache_release(c, a2);
+	json_image_cache_release(c, b);
+	json_image_cache_release(c, a);
+	json_image_cache_free(c);
+
+	/* Threads share a cache that is too small for every document */
+	shared = json_image_cache_new(3 * one);
+	assert(shared);
+	for (i = 0; i < NTHREADS; i++)
+		assert(pthread_create(&threads[i], NULL, worker,
+		    (void *)(size_t)(i + 1)) == 0);
+	for (i = 0; i < NTHREADS; i++)
+		assert(pthread_join(threads[i], NULL) == 0);
+	assert(json_image_cache_size(shared) <= 3 * one);
+	json_image_cache_free(shared);
+
+	return 0;
+}
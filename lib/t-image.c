@@ -0,0 +1,167 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+static const char doc[] =
+    " {\"name\": \"srv\", \"ports\": [80, 443, {\"alt\": [8080]}],"
+    " \"k\": 1, limits: {cpu: 4, \"mem\\u00e9\": \"2G\"}, \"k\": 2,"
+    " \"\": \"empty\", \"a.b\": 5, \"nested\": [[], [[7]], {}]}";
+
+/* The empty path selects the whole value. Calling through a pointer
+ * avoids the warning for an empty format. */
+static const char *(*select_path)(const void *, const char *, ...) =
+	json_image_select;
+
+/* Selects with the image and with json_select(), which must agree */
+static void
+check_path(const void *image, const char *path)
+{
+	const char *want = json_select(doc, path);
+	const char *got = json_image_select(image, path);
+
+	if (!want) {
+		assert(got == NULL);
+		return;
+	}
+	assert(got != NULL);
+	assert_inteq(json_span(got), json_span(want));
+	assert_memeq(got, want, json_span(want));
+}
+
+int
+main()
+{
+	static const char *const paths[] = {
+		"", "name", ".name", "ports", "ports[0]", "ports[1]",
+		"ports[2].alt[0]", "ports[3]", "ports[2].alt[1]", "k",
+		"limits.cpu", "limits.mem\xc3\xa9", "limits.mem", "nested[0]",
+		"nested[1][0][0]", "nested[2]", "nested[0][0]", "name[0]",
+		"name.x", "missing", "ports.alt", "k.x",
+	};
+	void *image, *copy;
+	size_t size, i;
+	char *shared;
+	pid_t pid;
+	int status;
+
+	/* A size request, then a build */
+	size = json_image_build(doc, 1, NULL, 0);
+	assert(size > sizeof doc);
+	image = malloc(size);
+	assert(image);
+	assert_errno(json_image_build(doc, 1, image, size - 1) == 0, ENOMEM);
+	assert_inteq(json_image_build(doc, 7, image, size), size);
+	assert_inteq(json_image_generation(image), 7);
+
+	/* Selections agree with json_select() */
+	for (i = 0; i < sizeof paths / sizeof paths[0]; i++)
+		check_path(image, paths[i]);
+
+	/* Duplicate keys find the first occurrence */
+	assert_inteq(json_as_int(json_image_select(image, "k")), 1);
+
+	/* Arguments are substituted as by json_select() */
+	assert_inteq(json_as_int(json_image_select(image, "ports[%d]", 1)),
+	    443);
+	assert_inteq(json_as_int(json_image_select(image, "%s.cpu",
+	    "limits")), 4);
+	assert_inteq(json_as_int(json_image_select(image, ".%s", "a.b")), 5);
+	assert_streq(json_image_select(image, ".%s", ""), "\"empty\", "
+	    "\"a.b\": 5, \"nested\": [[], [[7]], {}]}");
+	assert_errno(json_image_select(image, "ports[%d]", -1) == NULL,
+	    ENOENT);
+	assert_errno(json_image_select(image, "ports[%u]", 3u) == NULL,
+	    ENOENT);
+
+	/* Bad paths, and failed selections */
+	assert_errno(json_image_select(image, "ports[x]") == NULL, EINVAL);
+	assert_errno(json_image_select(image, "name..x") == NULL, EINVAL);
+	assert_errno(json_image_select(image, "nope") == NULL, ENOENT);
+	assert_errno(json_image_select(image, "name.x") == NULL, ENOENT);
+	errno = ENOENT;
+	assert(json_image_select(image, "ports[0]"));
+	assert_inteq(errno, 0);
+
+	/* The image works wherever it is copied */
+	copy = malloc(size);
+	assert(copy);
+	memcpy(copy, image, size);
+	memset(image, 0, size);
+	assert_errno(json_image_generation(image) == 0, EINVAL);
+	assert_errno(json_image_select(image, "name") == NULL, EINVAL);
+	assert_inteq(json_as_int(json_image_select(copy, "ports[2].alt[0]")),
+	    8080);
+	free(copy);
+	free(image);
+
+	/* An allocated image is the one json_image_build() builds */
+	image = json_image_new(doc, 3);
+	assert(image);
+	assert_inteq(json_image_generation(image), 3);
+	assert_inteq(json_as_int(json_image_select(image, "ports[1]")), 443);
+	free(image);
+	assert_errno(json_image_new("[1,,2]", 1) == NULL, EINVAL);
+	assert_errno(json_image_new("[]", 0) == NULL, EINVAL);
+
+	/* Scalars and empty containers are images too */
+	{
+		static char buf[256] __attribute__((aligned(8)));
+
+		assert(json_image_build(" 42 ", 1, buf, sizeof buf));
+		assert_inteq(json_as_int(select_path(buf, "")), 42);
+		assert_errno(json_image_select(buf, "[0]") == NULL, ENOENT);
+		assert(json_image_build("[]", 2, buf, sizeof buf));
+		assert_errno(json_image_select(buf, "[0]") == NULL, ENOENT);
+		assert_inteq(json_image_generation(buf), 2);
+	}
+
+	/* Bad documents and arguments */
+	{
+		static char buf[256] __attribute__((aligned(8)));
+
+		assert_errno(json_image_build("}", 1, buf, sizeof buf) == 0,
+		    EINVAL);
+		assert_errno(json_image_build(" ", 1, buf, sizeof buf) == 0,
+		    EINVAL);
+		assert_errno(json_image_build(NULL, 1, buf, sizeof buf) == 0,
+		    EINVAL);
+		/* Members that json_select() would reject */
+		assert_errno(json_image_build("[1,,2]", 1, buf,
+		    sizeof buf) == 0, EINVAL);
+		assert_errno(json_image_build("{\"a\":1,,\"b\":2}", 1, buf,
+		    sizeof buf) == 0, EINVAL);
+		assert_errno(json_image_build("[[1,,2]]", 1, buf,
+		    sizeof buf) == 0, EINVAL);
+		assert_errno(json_image_build("[]", 0, buf, sizeof buf) == 0,
+		    EINVAL);
+		assert_errno(json_image_build("[]", 1, buf + 1, 100) == 0,
+		    EINVAL);
+		assert_errno(json_image_generation(NULL) == 0, EINVAL);
+	}
+
+	/* One process builds into shared memory; another selects from it */
+	shared = mmap(NULL, 4096, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	assert(shared != MAP_FAILED);
+	pid = fork();
+	assert(pid != -1);
+	if (pid == 0)
+		_exit(json_image_build(doc, 3, shared, 4096) ? 0 : 1);
+	assert(waitpid(pid, &status, 0) == pid);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	assert_inteq(json_image_generation(shared), 3);
+	assert_streq(json_image_select(shared, "limits.mem\xc3\xa9"),
+	    "\"2G\"}, \"k\": 2, \"\": \"empty\", \"a.b\": 5, "
+	    "\"nested\": [[], [[7]], {}]}");
+	munmap(shared, 4096);
+
+	return 0;
+}
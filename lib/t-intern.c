@@ -0,0 +1,123 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+#define NTHREADS	4
+#define NKEYS		5000
+
+static struct json_intern *shared;
+static int ids[NTHREADS][NKEYS];
+
+/* Adds every key, in an order that differs between threads,
+ * while looking up the keys that other threads are adding */
+static void *
+adder(void *arg)
+{
+	int n = (int)(size_t)arg;
+	char key[32];
+	int i, k, id;
+
+	for (i = 0; i < NKEYS; i++) {
+		k = (i * 7919 + n * 1237) % NKEYS;
+		snprintf(key, sizeof key, "k%d", k);
+		id = json_intern_add(shared, key);
+		assert(id >= 0 && id < NKEYS);
+		ids[n][k] = id;
+		assert(strcmp(json_intern_name(shared, id), key) == 0);
+		snprintf(key, sizeof key, "\"k%d\"", (k + 1) % NKEYS);
+		id = json_intern_key_id(shared, key);
+		assert(id >= -1 && id < NKEYS);
+		/* An id that was found always has its name */
+		assert(id == -1 || json_intern_name(shared, id) != NULL);
+	}
+	return NULL;
+}
+
+int
+main()
+{
+	pthread_t threads[NTHREADS];
+	struct json_intern *t;
+	const char *ji;
+	const char *value;
+	char key[32];
+	int id;
+	int i;
+
+	t = json_intern_new();
+	assert(t);
+
+	/* Happy path: keys get ids in the order they are added */
+	assert_inteq(json_intern_add(t, "id"), 0);
+	assert_inteq(json_intern_add(t, "name"), 1);
+	assert_inteq(json_intern_add(t, "\xc3\xa9t\xc3\xa9"), 2);
+	assert_inteq(json_intern_add(t, "id"), 0);
+	assert_inteq(json_intern_lookup(t, "name"), 1);
+	assert_streq(json_intern_name(t, 2), "\xc3\xa9t\xc3\xa9");
+
+	/* Unknown keys and ids are not found */
+	assert_inteq_errno(json_intern_lookup(t, "nam"), -1, ENOENT);
+	assert_inteq_errno(json_intern_lookup(t, ""), -1, ENOENT);
+	assert_errno(json_intern_name(t, 3) == NULL, ENOENT);
+	assert_errno(json_intern_name(t, -1) == NULL, ENOENT);
+
+	/* JSON strings are looked up by their decoded content */
+	assert_inteq(json_intern_key_id(t, " \"name\""), 1);
+	assert_inteq(json_intern_key_id(t, "\"\\u00e9t\\u00e9\""), 2);
+	assert_inteq(json_intern_key_id(t, "'id'"), 0);
+	assert_inteq(json_intern_key_id(t, "id"), 0);
+	assert_inteq_errno(json_intern_key_id(t, "\"ids\""), -1, ENOENT);
+	assert_inteq_errno(json_intern_key_id(t, "[]"), -1, EINVAL);
+	assert_inteq_errno(json_intern_key_id(t, NULL), -1, EINVAL);
+
+	/* Objects can be iterated by key id */
+	ji = json_as_object("{\"name\": \"x\", \"other\": 5, \"\\u0069d\": 7}");
+	assert((value = json_object_next_id(&ji, t, &id)));
+	assert_inteq(id, 1);
+	assert_streq(value, "\"x\", \"other\": 5, \"\\u0069d\": 7}");
+	assert((value = json_object_next_id(&ji, t, &id)));
+	assert_inteq(id, -1);
+	assert((value = json_object_next_id(&ji, t, &id)));
+	assert_inteq(id, 0);
+	assert_inteq(json_as_int(value), 7);
+	assert(!json_object_next_id(&ji, t, &id));
+
+	/* The table grows to hold many keys */
+	for (i = 0; i < 1000; i++) {
+		sprintf(key, "key%d", i);
+		assert_inteq(json_intern_add(t, key), i + 3);
+	}
+	for (i = 0; i < 1000; i++) {
+		sprintf(key, "\"key%d\"", i);
+		assert_inteq(json_intern_key_id(t, key), i + 3);
+	}
+	assert_inteq(json_intern_lookup(t, "id"), 0);
+
+	json_intern_free(t);
+	json_intern_free(NULL);
+
+	/* Threads may add keys concurrently, and each key gets one id */
+	shared = json_intern_new();
+	assert(shared);
+	for (i = 0; i < NTHREADS; i++)
+		assert(pthread_create(&threads[i], NULL, adder,
+		    (void *)(size_t)i) == 0);
+	for (i = 0; i < NTHREADS; i++)
+		assert(pthread_join(threads[i], NULL) == 0);
+	for (i = 0; i < NKEYS; i++) {
+		int n;
+		for (n = 1; n < NTHREADS; n++)
+			assert_inteq(ids[n][i], ids[0][i]);
+		sprintf(key, "k%d", i);
+		assert_inteq(json_intern_lookup(shared, key), ids[0][i]);
+	}
+	assert_errno(json_intern_name(shared, NKEYS) == NULL, ENOENT);
+	json_intern_free(shared);
+
+	return 0;
+}
@@ -0,0 +1,218 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+/*
+ * Checks that hostile inputs take time in proportion to their size.
+ *
+ * Each pathological input is generated at a small and a large size,
+ * and each function is timed on both. Linear functions take about
+ * SCALE times as long on the large input; quadratic ones take about
+ * SCALE^2 times. The test fails when the ratio exceeds SLACK times
+ * the linear expectation, which leaves room for cache effects and
+ * timing noise but not for super-linear behaviour.
+ */
+#define SCALE	8
+#define SLACK	3.0
+#define MIN_CLOCKS	(CLOCKS_PER_SEC / 200)	/* 5 ms per measurement */
+#define TRIALS	3
+
+/** Builds text from a head, a body repeated n times, and a tail */
+static char *
+generate(const char *head, const char *body, size_t n, const char *tail)
+{
+	size_t headlen = strlen(head), bodylen = strlen(body);
+	size_t len = headlen + bodylen * n + strlen(tail);
+	char *text = malloc(len + 1);
+	char *p = text;
+	size_t i;
+
+	assert(text);
+	memcpy(p, head, headlen);
+	p += headlen;
+	for (i = 0; i < n; i++, p += bodylen)
+		memcpy(p, body, bodylen);
+	strcpy(p, tail);
+	return text;
+}
+
+/* The functions under test, with a common signature */
+static size_t
+do_span(const char *json)
+{
+	return json_span(json);
+}
+
+static size_t
+do_select(const char *json)
+{
+	return json_select(json, "missing.key") != NULL;
+}
+
+static size_t
+do_select_index(const char *json)
+{
+	return json_select(json, "[%d]", 1000000) != NULL;
+}
+
+static size_t
+do_as_str(const char *json)
+{
+	return json_as_str(json, NULL, 0);
+}
+
+static size_t
+do_as_utf8b(const char *json)
+{
+	return json_as_utf8b(json, NULL, 0);
+}
+
+static size_t
+do_as_bytes(const char *json)
+{
+	return json_as_bytes(json, NULL, 0);
+}
+
+static size_t
+do_image_build(const char *json)
+{
+	return json_image_build(json, 1, NULL, 0);
+}
+
+/** Returns the least CPU time per call of a function, over some trials */
+static double
+time_per_call(size_t (*fn)(const char *), const char *json)
+{
+	double best = 0;
+	int trial;
+
+	for (trial = 0; trial < TRIALS; trial++) {
+		clock_t start = clock(), elapsed;
+		unsigned long calls = 0;
+		double t;
+
+		do {
+			(void) fn(json);
+			calls++;
+		} while ((elapsed = clock() - start) < MIN_CLOCKS);
+		t = (double)elapsed / calls;
+		if (!trial || t < best)
+			best = t;
+	}
+	return best;
+}
+
+/** Asserts that a function's time grows linearly from one input to
+ * another that is larger, and frees them */
+static void
+check_ratio(const char *name, size_t (*fn)(const char *),
+	char *small, char *large)
+{
+	double size_ratio = (double)strlen(large) / strlen(small);
+	double ratio;
+
+	ratio = time_per_call(fn, large) / time_per_call(fn, small);
+	if (ratio > size_ratio * SLACK) {
+		/* Measure again, in case the machine was busy */
+		ratio = time_per_call(fn, large) / time_per_call(fn, small);
+	}
+	if (ratio > size_ratio * SLACK) {
+		fprintf(stderr, "%s: %zu -> %zu bytes took %.1fx as long\n",
+		    name, strlen(small), strlen(large), ratio);
+		abort();
+	}
+	free(small);
+	free(large);
+}
+
+/** Asserts that a function's time grows linearly with an input */
+static void
+check_linear(const char *name, size_t (*fn)(const char *),
+	const char *head, const char *body, size_t n, const char *tail)
+{
+	check_ratio(name, fn, generate(head, body, n, tail),
+	    generate(head, body, n * SCALE, tail));
+}
+
+/** Builds n nested objects, each with a member before and after */
+static char *
+nested(size_t n)
+{
+	char *open = generate("", "{\"k\":1,\"v\":[", n, "0");
+	char *text = generate(open, "],\"z\":2}", n, "");
+
+	free(open);
+	return text;
+}
+
+int
+main()
+{
+	char *deep;
+	char *nest;
+
+	/* Long runs of backslashes */
+	check_linear("span backslashes", do_span, "\"", "\\\\", 4096, "\"");
+	check_linear("span backslashes unterminated", do_span,
+	    "\"", "\\\\", 4096, "");
+	check_linear("as_str backslashes", do_as_str, "\"", "\\\\", 4096, "\"");
+	check_linear("as_str backslash quotes", do_as_str,
+	    "\"", "\\\"", 4096, "\"");
+
+	/* Huge words */
+	check_linear("span word", do_span, "", "a", 16384, "");
+	check_linear("as_str word", do_as_str, "", "a", 16384, "");
+	check_linear("select word", do_select, "{\"a\":", "a", 16384, "}");
+
+	/* Surrogate escapes, paired and unpaired */
+	check_linear("as_str surrogates", do_as_str,
+	    "\"", "\\ud83d\\ude00", 1024, "\"");
+	check_linear("as_utf8b lone surrogates", do_as_utf8b,
+	    "\"", "\\ud800", 2048, "\"");
+	check_linear("as_utf8b broken escapes", do_as_utf8b,
+	    "\"", "\\u12", 2048, "\"");
+
+	/* Nesting near the depth limit, repeated */
+	deep = malloc(2 * 32000 + 2);
+	assert(deep);
+	memset(deep, '[', 32000);
+	memset(deep + 32000, ']', 32000);
+	strcpy(deep + 64000, ",");
+	check_linear("span deep", do_span, "[", deep, 2, "0]");
+	check_linear("select deep", do_select, "{\"a\":[", deep, 2, "0]}");
+	check_linear("select index deep", do_select_index, "[", deep, 2, "0]");
+	/* Nesting beyond the limit is rejected */
+	nest = generate("", "[", 40000, "");
+	assert_errno(json_span(nest) == 0, ENOMEM);
+	free(deep);
+	free(nest);
+
+	/* Images index every container in one pass, however deep */
+	check_ratio("image_build nested", do_image_build, nested(1900),
+	    nested(1900 * SCALE));
+
+	/* Many keys and elements */
+	check_linear("select keys", do_select, "{", "\"key\":\"value\",", 1024,
+	    "}");
+	check_linear("select escaped keys", do_select, "{",
+	    "\"\\u006b\\u0065\\u0079\":1,", 1024, "}");
+	check_linear("select missing index", do_select_index, "[", "[{}],",
+	    1024, "0]");
+	check_linear("image_build keys", do_image_build, "{",
+	    "\"key\":[1],", 1024, "\"z\":0}");
+
+	/* BASE-64 data, with and without whitespace */
+	check_linear("as_bytes", do_as_bytes, "\"", "QUJD", 4096, "\"");
+	check_linear("as_bytes spaced", do_as_bytes, "\"", "QU JD ", 4096,
+	    "\"");
+	check_linear("as_bytes invalid", do_as_bytes, "\"", "QUJD", 4096,
+	    "!\"");
+
+	return 0;
+}
@@ -0,0 +1,65 @@
+#include <errno.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+int
+main()
+{
+	char buf[256];
+	const char *i, *r;
+	size_t done;
+
+	/* Happy path: iterating over complete records */
+	i = "{\"a\":1}\n[2]\r\n  3 \n";
+	/* its first record is an object */
+	assert((r = json_lines_next(&i)));
+	assert_inteq(json_select_int(r, "a"), 1);
+	/* its second record is an array */
+	assert((r = json_lines_next(&i)));
+	assert_inteq(json_select_int(r, "[0]"), 2);
+	/* its third record has its leading whitespace skipped */
+	assert((r = json_lines_next(&i)));
+	assert_chareq(*r, '3');
+	/* there are no more records, and nothing is pending */
+	assert_errno(!json_lines_next(&i), 0);
+	assert_chareq(*i, '\0');
+
+	/* Blank lines are skipped */
+	i = "\n \n\t\r\n7\n\n";
+	assert((r = json_lines_next(&i)));
+	assert_inteq(json_as_int(r), 7);
+	assert_errno(!json_lines_next(&i), 0);
+
+	/* A partial last line is left pending at the iterator */
+	strcpy(buf, "1\n{\"b\":");
+	i = buf;
+	assert((r = json_lines_next(&i)));
+	assert_errno(!json_lines_next(&i), EAGAIN);
+	assert(i == buf + 2);
+	/* and calling again doesn't advance over it */
+	assert_errno(!json_lines_next(&i), EAGAIN);
+	assert(i == buf + 2);
+
+	/* Iteration resumes from an offset after text is appended */
+	done = i - buf;
+	strcat(buf, "2}\n\n{\"b\":3");
+	i = buf + done;
+	assert((r = json_lines_next(&i)));
+	assert_inteq(json_select_int(r, "b"), 2);
+	assert_errno(!json_lines_next(&i), EAGAIN);
+	assert_inteq(json_select_int(i, "b"), 3);
+
+	/* A pending line of whitespace is not an incomplete record */
+	i = "1\n  ";
+	assert(json_lines_next(&i));
+	assert_errno(!json_lines_next(&i), 0);
+	assert_streq(i, "  ");
+
+	/* A NULL iterator has no records */
+	i = NULL;
+	assert(!json_lines_next(&i));
+
+	return 0;
+}
@@ -0,0 +1,150 @@
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+int
+main()
+{
+	float f[4];
+	char buf[256];
+	size_t i;
+
+	/* Happy path: converting an array of numbers to floats */
+	assert_inteq_errno(json_as_float_array("[1, 0.1, -2.5e3]", f, 4), 3, 0);
+	assert_doubleeq(f[0], 1.f);
+	assert_doubleeq(f[1], 0.1f);
+	assert_doubleeq(f[2], -2.5e3f);
+
+	/* Elements agree with json_as_float() */
+	assert_inteq(json_as_float_array("[1.00000005960464477550, 1e-50]",
+	    f, 4), 2);
+	assert_doubleeq(f[0], json_as_float("1.00000005960464477550"));
+	assert_doubleeq(f[1], 0);
+
+	/* A zero-sized buffer requests the element count */
+	assert_inteq_errno(json_as_float_array("[1,2,3,4,5]", NULL, 0), 5, 0);
+	assert_inteq_errno(json_as_float_array(" [ ] ", NULL, 0), 0, 0);
+
+	/* A small buffer is filled, but is an error */
+	assert_inteq_errno(json_as_float_array("[1,2,3,4,5]", f, 4), 0, ENOMEM);
+	assert_doubleeq(f[3], 4.f);
+
+	/* Non-numeric elements are converted, but signal EINVAL */
+	assert_inteq_errno(json_as_float_array("[null, \"2\", 3]", f, 4), 3,
+	    EINVAL);
+	assert_doubleeq(f[0], NAN);
+	assert_doubleeq(f[1], 2.f);
+	assert_doubleeq(f[2], 3.f);
+
+	/* Non-arrays and malformed arrays are invalid */
+	assert_inteq_errno(json_as_float_array(NULL, f, 4), 0, EINVAL);
+	assert_inteq_errno(json_as_float_array("1", f, 4), 0, EINVAL);
+	assert_inteq_errno(json_as_float_array("[1,2", f, 4), 0, EINVAL);
+	assert_inteq_errno(json_as_float_array("[1:2]", f, 4), 0, EINVAL);
+
+	/* Happy path: arrays of numbers convert to JSON */
+	{
+		static const double d[] = { 0.1, -2, 1.5e300, 1e-7, 0.000123,
+		    123456.789, -0.0, 0.1 + 0.2 };
+		assert_inteq(json_from_double_array(d, 8, buf, sizeof buf), 67);
+		assert_streq(buf, "[0.1,-2,1.5e+300,1e-07,"
+		    "0.000123,123456.789,-0,0.30000000000000004]");
+	}
+	{
+		static const float fl[] = { 0.1f, -3.25f, 16777216.f, 1e-10f };
+		assert_inteq(json_from_float_array(fl, 4, buf, sizeof buf), 27);
+		assert_streq(buf, "[0.1,-3.25,16777216,1e-10]");
+	}
+	{
+		static const int64_t n[] = { 0, -1, 42, INT64_MIN, INT64_MAX };
+		assert_inteq(json_from_int64_array(n, 5, buf, sizeof buf), 51);
+		assert_streq(buf, "[0,-1,42,-9223372036854775808,"
+		    "9223372036854775807]");
+
+		/* Size requests are exact, and within the bounds */
+		assert_inteq(json_from_int64_array(n, 5, NULL, 0), 51);
+		assert(51 <= JSON_FROM_INT64_ARRAY_DSTSZ(5));
+
+		/* A small buffer is an error */
+		assert_errno(json_from_int64_array(n, 5, buf, 50) == 0, ENOMEM);
+		assert_streq(buf, "");
+		assert_errno(json_from_int64_array(n, 5, buf, 1) == 0, ENOMEM);
+		assert_inteq(json_from_int64_array(n, 5, buf, 51), 51);
+	}
+
+	/* Empty arrays */
+	assert_inteq(json_from_double_array(NULL, 0, buf, sizeof buf), 3);
+	assert_streq(buf, "[]");
+	assert_errno(json_from_double_array(NULL, 0, buf, 2) == 0, ENOMEM);
+
+	/* Infinities and NaN are invalid */
+	{
+		double d[] = { 1, NAN };
+		float fl[] = { INFINITY };
+		assert_errno(json_from_double_array(d, 2, buf, sizeof buf) == 0,
+		    EINVAL);
+		assert_streq(buf, "");
+		assert_errno(json_from_float_array(fl, 1, NULL, 0) == 0,
+		    EINVAL);
+	}
+
+	/* Numbers are written in the fewest digits that read back the
+	 * same, from subnormals to the largest, and on either side of
+	 * the switch to exponents */
+	{
+		static const struct {
+			double d;
+			const char *json;
+		} doubles[] = {
+			{ 5e-324, "[5e-324]" },		/* least subnormal */
+			{ 2.225073858507201e-308, "[2.225073858507201e-308]" },
+			{ 2.2250738585072014e-308,	/* least normal */
+			  "[2.2250738585072014e-308]" },
+			{ 1.7976931348623157e308, "[1.7976931348623157e+308]" },
+			/* 2^53, and halfway to the next double */
+			{ 9007199254740992.0, "[9007199254740992]" },
+			{ 9007199254740993.0, "[9007199254740992]" },
+			{ 9007199254740994.0, "[9007199254740994]" },
+			{ 1e16, "[1e+16]" },
+			{ 1e23, "[1e+23]" },
+			{ 1e-6, "[0.000001]" },
+			{ 5e-7, "[5e-07]" },
+			{ 4.35, "[4.35]" },
+			{ 2.5, "[2.5]" },
+		};
+		static const struct {
+			float f;
+			const char *json;
+		} floats[] = {
+			{ 1e-45f, "[1e-45]" },		/* least subnormal */
+			{ 1.1754942e-38f, "[1.1754942e-38]" },
+			{ 1.17549435e-38f,		/* least normal */
+			  "[1.1754944e-38]" },
+			{ 3.4028235e38f, "[3.4028235e+38]" },
+			/* 2^24, and halfway to the next float */
+			{ 16777216.f, "[16777216]" },
+			{ 16777217.f, "[16777216]" },
+			{ 7.038531e-26f, "[7.038531e-26]" },
+			{ 1e10f, "[1e+10]" },
+			{ 1e-6f, "[1e-06]" },
+			{ 0.1f, "[0.1]" },
+		};
+
+		for (i = 0; i < sizeof doubles / sizeof doubles[0]; i++) {
+			assert_inteq(json_from_double_array(&doubles[i].d, 1,
+			    buf, sizeof buf), strlen(doubles[i].json) + 1);
+			assert_streq(buf, doubles[i].json);
+		}
+		for (i = 0; i < sizeof floats / sizeof floats[0]; i++) {
+			assert_inteq(json_from_float_array(&floats[i].f, 1,
+			    buf, sizeof buf), strlen(floats[i].json) + 1);
+			assert_streq(buf, floats[i].json);
+		}
+	}
+
+	return 0;
+}
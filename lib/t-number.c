@@ -160,5 +160,22 @@ main()
 	assert_inteq_errno(json_as_int("1e-9999"), 0, 0);
 	assert_longeq_errno(json_as_long("1e-9999"), 0, 0);
 
+	/* Floats convert directly, without double rounding via double */
+	assert_doubleeq_errno(json_as_float("0.1"), 0.1f, 0);
+	assert_doubleeq_errno(json_as_float(" -2.5e-3"), -2.5e-3f, 0);
+	assert_doubleeq_errno(json_as_float("16777217"), 16777217.f, 0);
+	assert_doubleeq_errno(json_as_float("3.4028234e38"), 3.4028234e38f, 0);
+	assert_doubleeq_errno(json_as_float("1.00000005960464477550"),
+	    1.00000005960464477550f, 0);
+
+	/* Float conversion has the same error handling as double */
+	assert_doubleeq_errno(json_as_float(NULL), NAN, EINVAL);
+	assert_doubleeq_errno(json_as_float("\"1.5\""), 1.5f, EINVAL);
+	assert_doubleeq_errno(json_as_float("+1.5"), 1.5f, EINVAL);
+	assert_doubleeq_errno(json_as_float("\"1z\""), NAN, EINVAL);
+	assert_doubleeq_errno(json_as_float("null"), NAN, EINVAL);
+	assert_doubleeq_errno(json_as_float("1e39"), HUGE_VALF, ERANGE);
+	assert_doubleeq_errno(json_as_float("-1e-99"), 0, ERANGE);
+
 	return 0;
 }
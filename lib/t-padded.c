@@ -0,0 +1,153 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+/* Inputs whose strings end in and around every vector width */
+static const char *const inputs[] = {
+	"\"\"",
+	"\"a\"",
+	"'it''s'",
+	"\"\\\"\\\\\"",
+	"\"caf\xc3\xa9 \xe2\x82\xac\"",
+	"[\"abc\", {\"k\": \"v\\n\"}, true]",
+	"\"unterminated",
+	"{\"a\":\"\\u00e9\"}",
+	"word",
+};
+
+#define MIN_CLOCKS	(CLOCKS_PER_SEC / 200)	/* 5 ms per measurement */
+#define TRIALS	3
+#define SLACK	1.25	/* for timing noise */
+
+/** Returns the least CPU time per call of a span function, over some
+ * trials */
+static double
+time_per_call(size_t (*fn)(const char *), const char *json)
+{
+	double best = 0;
+	int trial;
+
+	for (trial = 0; trial < TRIALS; trial++) {
+		clock_t start = clock(), elapsed;
+		unsigned long calls = 0;
+		double t;
+
+		do {
+			(void) fn(json);
+			calls++;
+		} while ((elapsed = clock() - start) < MIN_CLOCKS);
+		t = (double)elapsed / calls;
+		if (!trial || t < best)
+			best = t;
+	}
+	return best;
+}
+
+/** Asserts that padded scanning of a body repeated n times inside
+ * head and tail is no slower than unpadded scanning */
+static void
+check_not_slower(const char *head, const char *body, size_t n,
+	const char *tail)
+{
+	size_t headlen = strlen(head), bodylen = strlen(body);
+	size_t len = headlen + bodylen * n + strlen(tail);
+	char *p = json_padded_alloc(len);
+	double span, padded;
+	int again;
+
+	assert(p);
+	memcpy(p, head, headlen);
+	for (len = headlen; n--; len += bodylen)
+		memcpy(p + len, body, bodylen);
+	strcpy(p + len, tail);
+	assert_inteq(json_span_padded(p), json_span(p));
+
+	/* Measure again, in case the machine was busy */
+	for (again = 0; again < 3; again++) {
+		span = time_per_call(json_span, p);
+		padded = time_per_call(json_span_padded, p);
+		if (padded <= span * SLACK)
+			break;
+	}
+	if (padded > span * SLACK) {
+		fprintf(stderr, "%s%s...: padded took %.2fx as long\n",
+		    head, body, padded / span);
+		abort();
+	}
+	free(p);
+}
+
+int
+main()
+{
+	char text[300];
+	char buf[400], pbuf[400];
+	char *p;
+	size_t i, len;
+
+	/* Allocation zeroes the NUL and the padding after the text */
+	p = json_padded_alloc(10);
+	assert(p);
+	for (i = 10; i < 10 + 1 + JSON_PADDING; i++)
+		assert_inteq(p[i], 0);
+	free(p);
+	p = json_padded_strndup("\"hi\"xyz", 4);
+	assert(p);
+	assert_streq(p, "\"hi\"");
+	assert_inteq(json_span_padded(p), 4);
+	assert_inteq(json_as_str_padded(p, buf, sizeof buf), 3);
+	assert_streq(buf, "hi");
+	free(p);
+	assert_errno(json_padded_alloc(SIZE_MAX) == NULL, ENOMEM);
+
+	/* Padded scanning agrees with unpadded scanning, whatever
+	 * the padding contains */
+	for (i = 0; i < sizeof inputs / sizeof inputs[0]; i++) {
+		len = strlen(inputs[i]);
+		p = json_padded_strndup(inputs[i], len);
+		assert(p);
+		memset(p + len + 1, '"', JSON_PADDING);
+		assert_inteq(json_span_padded(p), json_span(inputs[i]));
+		assert_inteq(json_as_str_padded(p, pbuf, sizeof pbuf),
+		    json_as_str(inputs[i], buf, sizeof buf));
+		assert_streq(pbuf, buf);
+		free(p);
+	}
+
+	/* Long strings ending at every offset, close to the end of
+	 * the text and so of the buffer */
+	for (len = 2; len < sizeof text; len++) {
+		memset(text, 'x', len);
+		text[0] = '"';
+		text[len - 1] = '"';
+		if (len > 4) {
+			text[len / 2 - 1] = '\\';
+			text[len / 2] = '/';
+		}
+		p = json_padded_strndup(text, len);
+		assert(p);
+		memset(p + len + 1, 'y', JSON_PADDING);
+		assert_inteq(json_span_padded(p), len);
+		assert_inteq(json_as_str_padded(p, buf, sizeof buf),
+		    len - 1 - (len > 4));
+		p[len - 1] = '\0';	/* unterminated */
+		assert_errno(json_as_str_padded(p, buf, sizeof buf) == 0,
+		    EINVAL);
+		assert_inteq(json_span_padded(p), len - 1);
+		free(p);
+	}
+
+	/* Padded scanning is no slower on short strings, nor on
+	 * strings that are mostly UTF-8 */
+	check_not_slower("[", "\"ab\",\"\",\"c\\n\",", 10000, "0]");
+	check_not_slower("\"", "\xce\xb1\xce\xb2\xce\xb3 \xe2\x82\xac", 100000,
+	    "\"");
+
+	return 0;
+}
@@ -0,0 +1,67 @@
+#include <errno.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+#define ALL (JSON_REDUCE_SUM | JSON_REDUCE_MIN | JSON_REDUCE_MAX | \
+	     JSON_REDUCE_MEAN)
+
+int
+main()
+{
+	struct json_reduce r;
+
+	/* Happy path: reducing an array of numbers */
+	assert_inteq(json_array_reduce_double("[1, 2.5, -3e1, 0.5]", ALL, &r),
+	    0);
+	assert_inteq(r.count, 4);
+	assert_inteq(r.skipped, 0);
+	assert_doubleeq(r.sum, -26);
+	assert_doubleeq(r.min, -30);
+	assert_doubleeq(r.max, 2.5);
+	assert_doubleeq(r.mean, -6.5);
+
+	/* Results agree with json_as_double() for long numbers */
+	assert_inteq(json_array_reduce_double(
+	    "[3.141592653589793238462643383279, 1e300, 12345678901234567890]",
+	    JSON_REDUCE_MAX | JSON_REDUCE_MIN, &r), 0);
+	assert_doubleeq(r.min, json_as_double("3.141592653589793238462643383279"));
+	assert_doubleeq(r.max, 1e300);
+
+	/* Results agree with json_as_double() for short decimals */
+	assert_inteq(json_array_reduce_double("[0.1]", JSON_REDUCE_SUM, &r), 0);
+	assert_doubleeq(r.sum, 0.1);
+	assert_inteq(json_array_reduce_double("[-0.000123e-3]",
+	    JSON_REDUCE_SUM, &r), 0);
+	assert_doubleeq(r.sum, -0.000123e-3);
+
+	/* Results that were not requested are NaN */
+	assert_inteq(json_array_reduce_double("[1,2]", JSON_REDUCE_SUM, &r), 0);
+	assert_doubleeq(r.sum, 3);
+	assert_doubleeq(r.min, NAN);
+	assert_doubleeq(r.max, NAN);
+	assert_doubleeq(r.mean, NAN);
+
+	/* Non-numeric elements are counted and skipped */
+	assert_inteq(json_array_reduce_double(
+	    "[null, 4, \"5\", [6], {\"a\":7}, 1.5e, 8,]", ALL, &r), 0);
+	assert_inteq(r.count, 2);
+	assert_inteq(r.skipped, 5);
+	assert_doubleeq(r.sum, 12);
+
+	/* An empty array has no minimum, maximum or mean */
+	assert_inteq(json_array_reduce_double("[ ]", ALL, &r), 0);
+	assert_inteq(r.count, 0);
+	assert_doubleeq(r.sum, 0);
+	assert_doubleeq(r.min, NAN);
+	assert_doubleeq(r.mean, NAN);
+
+	/* Non-arrays and malformed arrays are invalid */
+	assert_errno(json_array_reduce_double(NULL, ALL, &r) == -1, EINVAL);
+	assert_errno(json_array_reduce_double("{}", ALL, &r) == -1, EINVAL);
+	assert_errno(json_array_reduce_double("[1,2", ALL, &r) == -1, EINVAL);
+	assert_errno(json_array_reduce_double("[1:2]", ALL, &r) == -1, EINVAL);
+
+	return 0;
+}
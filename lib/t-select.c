@@ -126,6 +126,87 @@ main()
 	assert_errno(!json_select("{\"a\":1,:,\"x\":0}", "x"), EINVAL);
 	assert_errno(!json_select("[0,1,2,:]", "[4]"), EINVAL);
 
+	/* Unquoted keys that do not match are not errors */
+	value = json_select("{a:1, b:2}", "b");
+	assert(value && *value == '2');
+	assert_inteq(json_select_int("{a:1, 'b':2, c:3}", "c"), 3);
+
+	/* Batch selection agrees with json_select() for each document */
+	{
+		const char *docs[] = {
+			input_A, "{\"hotel\":[0,{\"cook\":7}]}", NULL,
+			"[]", input_A, "{\"hotel\":[1,{\"cook\":8}]}",
+			"{\"hotel\":[2,{\"cook\":9}]}", "", input_A,
+			"{\"hotel\":[3,{\"cook\":10}]}"
+		};
+		const size_t n = sizeof docs / sizeof docs[0];
+		const char *out[sizeof docs / sizeof docs[0]];
+		size_t i;
+
+		assert_inteq(json_select_batch(docs, n, "hotel[1].cook", out),
+		    7);
+		for (i = 0; i < n; i++)
+			assert(out[i] == json_select(docs[i], "hotel[1].cook"));
+	}
+
+	/* Batch selection rejects malformed paths and argument references */
+	{
+		const char *docs[] = { input_A };
+		const char *out[1];
+
+		assert_errno(json_select_batch(docs, 1, "hotel[x]", out) == 0,
+		    EINVAL);
+		assert(!out[0]);
+		assert_errno(json_select_batch(docs, 1, "%s", out) == 0,
+		    EINVAL);
+		assert(!out[0]);
+	}
+
+	/* Case-insensitive selection folds ASCII keys */
+	{
+		const char doc[] = "{\"UserId\": 1, \"NAME\": {\"First\": 2},"
+		    " \"esc\\u0041pe\": 4, \"userid\": 5, Word: 3}";
+
+		assert_inteq(json_as_int(json_iselect(doc, "userid")), 1);
+		assert_inteq(json_as_int(json_iselect(doc, "USERID")), 1);
+		assert_inteq(json_as_int(json_iselect(doc, "name.first")), 2);
+		assert_inteq(json_as_int(json_iselect(doc, ".%s.%s", "Name",
+		    "FIRST")), 2);
+		assert_inteq(json_as_int(json_iselect(doc, "word")), 3);
+		assert_inteq(json_as_int(json_iselect(doc, "ESCAPE")), 4);
+		assert_errno(!json_iselect(doc, "user"), ENOENT);
+		assert_errno(!json_iselect(doc, "userids"), ENOENT);
+		assert_errno(!json_iselect(doc, "name.firs"), ENOENT);
+		/* Plain selection still matches case */
+		assert_inteq(json_as_int(json_select(doc, "userid")), 5);
+		assert_errno(!json_select(doc, "USERID"), ENOENT);
+	}
+
+	/* Case-insensitive selection folds other scripts */
+	{
+		const char doc[] = "{\"Stra\u1e9ee\": 1, \"\u0391\u0398\u0397\u039d\u0391\": 2,"
+		    " \"\u041c\u043e\u0441\u043a\u0432\u0430\": 3,"
+		    " \"\u00c9t\u00c9\": 4, \"\u212aelvin\": 5,"
+		    " \"\u4e2d\u6587\": 6, \"\u0218\u021a\": 7, \"\u1f08\": 8,"
+		    " \"\ua640\": 9}";
+
+		assert_inteq(json_as_int(json_iselect(doc,
+		    "stra\xc3\x9f" "e")), 1);
+		assert_inteq(json_as_int(json_iselect(doc,
+		    "\xce\xb1\xce\xb8\xce\xb7\xce\xbd\xce\xb1")), 2);
+		assert_inteq(json_as_int(json_iselect(doc,
+		    "\xd0\x9c\xd0\x9e\xd0\xa1\xd0\x9a\xd0\x92\xd0\x90")), 3);
+		assert_inteq(json_as_int(json_iselect(doc,
+		    "\xc3\xa9t\xc3\xa9")), 4);
+		assert_inteq(json_as_int(json_iselect(doc, "KELVIN")), 5);
+		assert_inteq(json_as_int(json_iselect(doc,
+		    "\xe4\xb8\xad\xe6\x96\x87")), 6);
+		assert_inteq(json_as_int(json_iselect(doc,
+		    "\xc8\x99\xc8\x9b")), 7);
+		assert_inteq(json_as_int(json_iselect(doc, "\xe1\xbc\x80")), 8);
+		assert_inteq(json_as_int(json_iselect(doc, "\xea\x99\x81")), 9);
+		assert_errno(!json_iselect(doc, "\xc3\xa9t\xc3\xa8"), ENOENT);
+	}
 
 	return 0;
 }
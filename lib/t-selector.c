@@ -0,0 +1,147 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+int
+main()
+{
+	const char input_A[] =
+	"{ \"hotel\": ["
+	      "null, "
+	      "{"
+	          "\"cook\": {"
+		      "\"name\": \"Mr LeChe\\ufb00\","
+		      "\"age\": 91,"
+		  "},"
+		  "\"scores\": [4,5, 1, 9, 0]"
+	      "}"
+	    "]"
+	"}";
+	char buf[sizeof input_A];
+	struct json_selector sel;
+	const char *value;
+	size_t n;
+
+	/* Happy path: receiving the text one byte at a time
+	 * eventually selects the same value as json_select() */
+	json_selector_init(&sel, "hotel[1].cook.age");
+	for (n = 0; n < sizeof input_A - 1; n++) {
+		memcpy(buf, input_A, n);
+		buf[n] = '\0';
+		errno = 0;
+		value = json_selector_resume(&sel, buf);
+		if (value)
+			break;
+		assert_errnoeq(errno, EAGAIN);
+	}
+	assert(value);
+	assert_inteq(value - buf,
+	    json_select(input_A, "hotel[1].cook.age") - input_A);
+	assert_inteq(json_as_int(value), 91);
+
+	/* A value is only selected once some text follows it */
+	json_selector_init(&sel, "[1]");
+	assert_errno(!json_selector_resume(&sel, "[1,23"), EAGAIN);
+	value = json_selector_resume(&sel, "[1,23 ");
+	assert(value);
+	assert_inteq(json_as_int(value), 23);
+
+	/* The text may move between calls */
+	json_selector_init(&sel, "b");
+	strcpy(buf, "{\"a\":1,");
+	assert_errno(!json_selector_resume(&sel, buf), EAGAIN);
+	strcpy(buf, "  ");
+	strcat(buf, "{\"a\":1,\"b\":[]}");
+	value = json_selector_resume(&sel, buf + 2);
+	assert(value);
+	assert_chareq(*value, '[');
+
+	/* Finishing treats the end of the text as the end of input */
+	json_selector_init(&sel, "[1]");
+	assert_errno(!json_selector_resume(&sel, "[1,2"), EAGAIN);
+	value = json_selector_finish(&sel, "[1,2");
+	assert(value);
+	assert_inteq(json_as_int(value), 2);
+	json_selector_init(&sel, "");
+	value = json_selector_finish(&sel, "7");
+	assert(value);
+	assert_inteq(json_as_int(value), 7);
+
+	/* Absent keys and indicies are detected before the input ends */
+	json_selector_init(&sel, "a.b");
+	assert_errno(!json_selector_resume(&sel, "{\"a\":{\"c\":1}"), ENOENT);
+	json_selector_init(&sel, "[3]");
+	assert_errno(!json_selector_resume(&sel, "[0,1] "), ENOENT);
+	json_selector_init(&sel, "x");
+	assert_errno(!json_selector_resume(&sel, "[{\"x\":1}"), ENOENT);
+
+	/* Truncated text is not found when finishing */
+	json_selector_init(&sel, "[3]");
+	assert_errno(!json_selector_finish(&sel, "[0,1"), ENOENT);
+
+	/* Argument references and malformed paths are invalid */
+	json_selector_init(&sel, "a.%s");
+	assert_errno(!json_selector_resume(&sel, "{\"a\":{}}"), EINVAL);
+	json_selector_init(&sel, "[x]");
+	assert_errno(!json_selector_resume(&sel, "[]"), EINVAL);
+
+	/* Chunks may end within strings, escapes, words and nesting */
+	{
+		static const char text[] =
+		    "{\"a\\\"b\": [[1, {\"x\": \"]\"}], 'it\\'s'], "
+		    "\"n\": [true, \"\\\\\", -12.5e3], \"k\": 42}";
+
+		json_selector_init(&sel, "n[2]");
+		for (n = 0; n < sizeof text - 1; n++) {
+			memcpy(buf, text, n);
+			buf[n] = '\0';
+			value = json_selector_resume(&sel, buf);
+			if (value)
+				break;
+			assert_errnoeq(errno, EAGAIN);
+		}
+		assert(value);
+		assert_doubleeq(json_as_double(value), -12.5e3);
+		json_selector_init(&sel, "k");
+		value = json_selector_finish(&sel, text);
+		assert_inteq(json_as_int(value), 42);
+	}
+
+	/* Mismatched brackets in skipped values are invalid */
+	json_selector_init(&sel, "[1]");
+	assert_errno(!json_selector_resume(&sel, "[[1}, 2]"), EINVAL);
+
+	/* A large value received a byte at a time is scanned once,
+	 * not again from its start on every call */
+	{
+		size_t len = 0, big = 4000000;
+		char *text = malloc(big + 32);
+
+		assert(text);
+		json_selector_init(&sel, "[1]");
+		text[len++] = '[';
+		text[len++] = '[';
+		while (len < big) {
+			text[len++] = '"';
+			text[len++] = '\\';
+			text[len++] = '"';
+			text[len++] = '"';
+			text[len++] = ',';
+			text[len] = '\0';
+			assert_errno(!json_selector_resume(&sel, text), EAGAIN);
+		}
+		strcpy(text + len, "0], 5]");
+		assert_inteq(json_as_int(json_selector_resume(&sel, text)), 5);
+		free(text);
+	}
+
+	/* Selecting within NULL text is not found */
+	json_selector_init(&sel, "a");
+	assert_errno(!json_selector_resume(&sel, NULL), ENOENT);
+
+	return 0;
+}
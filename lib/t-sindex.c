@@ -0,0 +1,99 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+int
+main()
+{
+	struct json_sorted_index idx;
+	static char big[65536];
+	char key[32];
+	int prev = -1;
+	size_t first;
+	int i;
+
+	/* Happy path: members are sorted by key */
+	assert_inteq(json_object_sorted_index(
+	    " {\"b\": 2, \"a\": 1, \"c\": 3, \"ab\": 4}", &idx), 0);
+	assert_inteq(idx.count, 4);
+	assert_streq(json_sorted_index_key(&idx, 0), "\"a\": 1, \"c\": 3, \"ab\": 4}");
+	assert_inteq(json_as_int(json_sorted_index_value(&idx, 1)), 4);
+	assert_inteq(json_as_int(json_sorted_index_value(&idx, 2)), 2);
+	assert_inteq(json_as_int(json_sorted_index_value(&idx, 3)), 3);
+
+	/* Keys are found by binary search */
+	assert_inteq(json_as_int(json_sorted_index_get(&idx, "ab")), 4);
+	assert_inteq(json_as_int(json_sorted_index_get(&idx, "c")), 3);
+	assert_errno(json_sorted_index_get(&idx, "aa") == NULL, ENOENT);
+	assert_errno(json_sorted_index_get(&idx, "d") == NULL, ENOENT);
+	assert_errno(json_sorted_index_get(&idx, "") == NULL, ENOENT);
+
+	/* Prefixes select a range of members */
+	assert_inteq(json_sorted_index_prefix(&idx, "a", &first), 2);
+	assert_inteq(first, 0);
+	assert_inteq(json_sorted_index_prefix(&idx, "b", &first), 1);
+	assert_inteq(first, 2);
+	assert_inteq(json_sorted_index_prefix(&idx, "", &first), 4);
+	assert_inteq(json_sorted_index_prefix(&idx, "abc", &first), 0);
+	assert_inteq(json_sorted_index_prefix(&idx, "z", NULL), 0);
+	json_sorted_index_free(&idx);
+
+	/* Escaped keys sort and match by code point */
+	assert_inteq(json_object_sorted_index(
+	    "{\"\\u00e9\": 1, \"z\": 2, \"\\ud83d\\ude00\": 3, \"\\u0041\": 4}",
+	    &idx), 0);
+	assert_inteq(json_as_int(json_sorted_index_value(&idx, 0)), 4);
+	assert_inteq(json_as_int(json_sorted_index_value(&idx, 1)), 2);
+	assert_inteq(json_as_int(json_sorted_index_value(&idx, 2)), 1);
+	assert_inteq(json_as_int(json_sorted_index_value(&idx, 3)), 3);
+	assert_inteq(json_as_int(json_sorted_index_get(&idx, "\xc3\xa9")), 1);
+	assert_inteq(json_as_int(json_sorted_index_get(&idx, "A")), 4);
+	json_sorted_index_free(&idx);
+
+	/* Duplicate keys find the first occurrence, like json_select() */
+	assert_inteq(json_object_sorted_index(
+	    "{\"k\": 1, \"j\": 0, \"k\": 2, \"k\": 3}", &idx), 0);
+	assert_inteq(json_as_int(json_sorted_index_get(&idx, "k")), 1);
+	assert_inteq(json_sorted_index_prefix(&idx, "k", &first), 3);
+	assert_inteq(json_as_int(json_sorted_index_value(&idx, first + 2)), 3);
+	json_sorted_index_free(&idx);
+
+	/* Large dictionaries support prefix scans */
+	strcpy(big, "{");
+	for (i = 999; i >= 0; i--)
+		sprintf(big + strlen(big), "%s\"user:%d:%d\":%d",
+		    i == 999 ? "" : ",", i / 10, i, i);
+	strcat(big, "}");
+	assert_inteq(json_object_sorted_index(big, &idx), 0);
+	assert_inteq(idx.count, 1000);
+	assert_inteq(json_sorted_index_prefix(&idx, "user:42:", &first), 10);
+	for (i = 0; i < 10; i++) {
+		int v = json_as_int(json_sorted_index_value(&idx, first + i));
+		assert_inteq(v / 10, 42);
+		assert(v > prev);
+		prev = v;
+	}
+	for (i = 0; i < 1000; i++) {
+		sprintf(key, "user:%d:%d", i / 10, i);
+		assert_inteq(json_as_int(json_sorted_index_get(&idx, key)), i);
+	}
+	json_sorted_index_free(&idx);
+
+	/* An empty object has no members */
+	assert_inteq(json_object_sorted_index("{}", &idx), 0);
+	assert_inteq(idx.count, 0);
+	assert_errno(json_sorted_index_get(&idx, "a") == NULL, ENOENT);
+	assert_inteq(json_sorted_index_prefix(&idx, "", NULL), 0);
+	json_sorted_index_free(&idx);
+
+	/* Non-objects and malformed objects are invalid */
+	assert_errno(json_object_sorted_index(NULL, &idx) == -1, EINVAL);
+	assert_errno(json_object_sorted_index("[]", &idx) == -1, EINVAL);
+	assert_errno(json_object_sorted_index("{\"a\":1", &idx) == -1, EINVAL);
+
+	return 0;
+}
@@ -91,5 +91,13 @@ main()
 	assert_errno(!json_span(nested_object(32769, "\"a\"", "0")), ENOMEM);
 	assert_errno(!json_span(nested_object(32770, "\"a\"", "0")), ENOMEM);
 
+	/* Unterminated strings are not measured beyond their NUL */
+	assert_inteq(json_span("\"ab"), 3);
+	assert_inteq(json_span("\"a\\"), 3);
+
+	/* Stray colons in arrays stop the measurement */
+	assert_inteq(json_span("[\"a\":1]"), 4);
+	assert_inteq(json_span("{\"a\"::1}"), 5);
+
 	return 0;
 }
@@ -0,0 +1,68 @@
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+/** Returns the i'th string of a packed string array */
+static const char *
+str_at(const struct json_str_array *a, size_t i)
+{
+	return a->data + a->offsets[i];
+}
+
+int
+main()
+{
+	struct json_str_array a;
+	char big[4096];
+	size_t i;
+
+	/* Happy path: strings are packed end to end */
+	assert_inteq(json_as_str_array("[\"ab\", \"\", \"c\\u00e9\"]", &a), 0);
+	assert_inteq(a.count, 3);
+	assert_streq(str_at(&a, 0), "ab");
+	assert_streq(str_at(&a, 1), "");
+	assert_streq(str_at(&a, 2), "c\xc3\xa9");
+	assert_inteq(a.offsets[1], 3);
+	assert_inteq(a.offsets[3], 3 + 1 + 4);
+	json_str_array_free(&a);
+	assert(!a.data && !a.offsets);
+
+	/* Words are converted like json_as_str() does */
+	assert_inteq(json_as_str_array("[null,true,12]", &a), 0);
+	assert_inteq(a.count, 3);
+	assert_streq(str_at(&a, 0), "null");
+	assert_streq(str_at(&a, 2), "12");
+	json_str_array_free(&a);
+
+	/* An empty array has no strings */
+	assert_inteq(json_as_str_array(" [ ] ", &a), 0);
+	assert_inteq(a.count, 0);
+	assert_inteq(a.offsets[0], 0);
+	json_str_array_free(&a);
+
+	/* Many strings grow the offsets */
+	strcpy(big, "[");
+	for (i = 0; i < 500; i++)
+		strcat(big, i ? ",\"x\"" : "\"x\"");
+	strcat(big, "]");
+	assert_inteq(json_as_str_array(big, &a), 0);
+	assert_inteq(a.count, 500);
+	assert_streq(str_at(&a, 499), "x");
+	assert_inteq(a.offsets[500], 1000);
+	json_str_array_free(&a);
+
+	/* Elements that are not strings are invalid */
+	assert_errno(json_as_str_array("[\"a\", [1]]", &a) == -1, EINVAL);
+	assert_errno(json_as_str_array("[\"\\udc00\"]", &a) == -1, EINVAL);
+
+	/* Non-arrays and malformed arrays are invalid */
+	assert_errno(json_as_str_array(NULL, &a) == -1, EINVAL);
+	assert_errno(json_as_str_array("\"a\"", &a) == -1, EINVAL);
+	assert_errno(json_as_str_array("[\"a\"", &a) == -1, EINVAL);
+	assert_errno(json_as_str_array("[\"a\":1]", &a) == -1, EINVAL);
+
+	return 0;
+}
@@ -285,5 +285,12 @@ main()
 	assert_good("\"/\\/\"", "//");
 	assert_good("\"\\\\\"", "\\");
 
+	/* Runs of UTF-8 are copied whole, up to escapes and bad bytes */
+	assert_good("\"caf\xc3\xa9 \xe2\x82\xac\\u00e9\xf0\x9f\x80\x9c\"",
+	    "caf\xc3\xa9 \xe2\x82\xac\xc3\xa9\xf0\x9f\x80\x9c");
+	assert_good("'\xc3\xa9\"\xc3\xa9'", "\xc3\xa9\"\xc3\xa9");
+	assert_unsafe("\"\xc3\xa9\xff\xc3\xa9\"", "\xc3\xa9\xed\xb3\xbf\xc3\xa9");
+	assert_unsafe("\"\xc3\xa9\xc3\"", "\xc3\xa9\xed\xb3\x83");
+
 	return 0;
 }
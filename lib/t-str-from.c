@@ -130,5 +130,12 @@ main()
 	assert_safe("</", "<\\/");
 	assert_safe("embed </ embed", "embed <\\/ embed");
 
+	/* Runs of UTF-8 are copied whole, up to the characters to escape */
+	assert_safe("caf\xc3\xa9 \xe2\x82\xac\"" U_1F01C "\n",
+	    "caf\xc3\xa9 \xe2\x82\xac\\\"" U_1F01C "\\n");
+	assert_safe("\xc3\xa9]]>\xc3\xa9<</", "\xc3\xa9]]\\u003e\xc3\xa9<<\\/");
+	assert_safe("]]]>]>", "]]]\\u003e]>");
+	assert_unsafe("\xc3\xa9" U_DC5C "\xc3\xa9", "\xc3\xa9\\\xc3\xa9");
+
 	return 0;
 }
@@ -0,0 +1,84 @@
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+int
+main()
+{
+	struct json_template *tpl;
+	char buf[256];
+
+	/* Happy path: slots are filled from the arguments */
+	tpl = json_template_compile(
+	    "{\"id\":%d,\"name\":%s,\"tags\":%raw,\"score\":%f,\"n\":%ld}");
+	assert(tpl);
+	assert_inteq(json_template_render(tpl, buf, sizeof buf,
+	    -42, "Bob \"B\"", "[1,2]", 0.1, 1234567890L), 70);
+	assert_streq(buf, "{\"id\":-42,\"name\":\"Bob \\\"B\\\"\","
+	    "\"tags\":[1,2],\"score\":0.1,\"n\":1234567890}");
+
+	/* A size request returns the size needed */
+	assert_inteq(json_template_render(tpl, NULL, 0,
+	    -42, "Bob \"B\"", "[1,2]", 0.1, 1234567890L), 70);
+
+	/* NULL strings become null */
+	assert_inteq(json_template_render(tpl, buf, sizeof buf,
+	    0, NULL, NULL, 1e300, -1L), 55);
+	assert_streq(buf, "{\"id\":0,\"name\":null,\"tags\":null,"
+	    "\"score\":1e+300,\"n\":-1}");
+
+	/* A small buffer is an error */
+	assert_errno(json_template_render(tpl, buf, 69,
+	    -42, "Bob \"B\"", "[1,2]", 0.1, 1234567890L) == 0, ENOMEM);
+	assert_streq(buf, "");
+	assert_errno(json_template_render(tpl, buf, 12,
+	    -42, "Bob \"B\"", "[1,2]", 0.1, 1234567890L) == 0, ENOMEM);
+	assert_errno(json_template_render(tpl, buf, 1,
+	    -42, "Bob \"B\"", "[1,2]", 0.1, 1234567890L) == 0, ENOMEM);
+
+	/* Bad strings and non-finite doubles are invalid */
+	assert_errno(json_template_render(tpl, buf, sizeof buf,
+	    1, "\xff", "[]", 0.0, 0L) == 0, EINVAL);
+	assert_streq(buf, "");
+	assert_errno(json_template_render(tpl, buf, sizeof buf,
+	    1, "", "[]", 1e308 * 10, 0L) == 0, EINVAL);
+	json_template_free(tpl);
+
+	/* Integers at their limits */
+	tpl = json_template_compile("[%d,%d,%ld,%d]");
+	assert(tpl);
+	assert_inteq(json_template_render(tpl, buf, sizeof buf,
+	    INT32_MIN, 7, (long)INT64_MIN, 10), 40);
+	assert_streq(buf, "[-2147483648,7,-9223372036854775808,10]");
+	json_template_free(tpl);
+
+	/* Doubles use the fewest digits that read back the same */
+	tpl = json_template_compile("[%f,%f,%f]");
+	assert(tpl);
+	json_template_render(tpl, buf, sizeof buf, 1.0 / 3, 100.0, -2.5e-7);
+	assert_streq(buf, "[0.3333333333333333,100,-2.5e-07]");
+	json_template_free(tpl);
+
+	/* Templates without slots, and %% */
+	tpl = json_template_compile("{\"pct\":\"100%%\"}");
+	assert(tpl);
+	assert_inteq(json_template_render(tpl, buf, sizeof buf), 15);
+	assert_streq(buf, "{\"pct\":\"100%\"}");
+	json_template_free(tpl);
+	tpl = json_template_compile("");
+	assert(tpl);
+	assert_inteq(json_template_render(tpl, buf, sizeof buf), 1);
+	assert_streq(buf, "");
+	json_template_free(tpl);
+
+	/* Unknown slots are invalid */
+	assert_errno(!json_template_compile("[%x]"), EINVAL);
+	assert_errno(!json_template_compile("[%"), EINVAL);
+	assert_errno(!json_template_compile(NULL), EINVAL);
+	json_template_free(NULL);
+
+	return 0;
+}
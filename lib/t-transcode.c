@@ -0,0 +1,98 @@
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+
+#include "redjson.h"
+#include "t-assert.h"
+
+/* Input literals may contain NULs, so their size excludes the last */
+#define SZ(lit)	(sizeof (lit) - 1)
+
+int
+main()
+{
+	char buf[256];
+	char src[64];
+	size_t i;
+
+	/* Happy path: UTF-16LE with a BOM converts to UTF-8 */
+	assert_inteq(json_detect_encoding("\xff\xfe{\0}\0", 6),
+	    JSON_ENCODING_UTF16LE);
+	assert_inteq(json_transcode(JSON_ENCODING_UTF16LE,
+	    "\xff\xfe{\0\"\0\xe9\0\"\0:\0=\xd8\x00\xde}\0", 18,
+	    buf, sizeof buf), 12);
+	assert_streq(buf, "{\"\xc3\xa9\":\xf0\x9f\x98\x80}");
+
+	/* UTF-16 without a BOM is recognised by its zero bytes */
+	assert_inteq(json_detect_encoding("[\0]\0", 4), JSON_ENCODING_UTF16LE);
+	assert_inteq(json_detect_encoding("\0[\0]", 4), JSON_ENCODING_UTF16BE);
+	assert_inteq(json_detect_encoding("\xfe\xff\0[", 4),
+	    JSON_ENCODING_UTF16BE);
+	assert_inteq(json_transcode(JSON_ENCODING_UTF16BE,
+	    "\0[\0 \0\"\x20\xac\0\"\0]", 12, buf, sizeof buf), 9);
+	assert_streq(buf, "[ \"\xe2\x82\xac\"]");
+
+	/* Long ASCII runs convert eight bytes at a time */
+	for (i = 0; i < 20; i++) {
+		src[2 * i] = "[\"abcdefghijklmnop\"]"[i];
+		src[2 * i + 1] = '\0';
+	}
+	assert_inteq(json_transcode(JSON_ENCODING_UTF16LE, src, 40,
+	    buf, sizeof buf), 21);
+	assert_streq(buf, "[\"abcdefghijklmnop\"]");
+	assert_inteq(json_transcode(JSON_ENCODING_UTF16BE, src + 1, 38,
+	    buf, sizeof buf), 20);
+	assert_streq(buf, "\"abcdefghijklmnop\"]");
+
+	/* Latin-1 is recognised when it is not valid UTF-8 */
+	assert_inteq(json_detect_encoding("\"caf\xe9 au lait\"", 15),
+	    JSON_ENCODING_LATIN1);
+	assert_inteq(json_transcode(JSON_ENCODING_LATIN1,
+	    "\"caf\xe9 au lait, s'il vous pla\xeet\"", 31, buf, sizeof buf),
+	    34);
+	assert_streq(buf, "\"caf\xc3\xa9 au lait, s'il vous pla\xc3\xaet\"");
+
+	/* UTF-8 is copied, without its BOM */
+	assert_inteq(json_detect_encoding("\"caf\xc3\xa9\"", 7),
+	    JSON_ENCODING_UTF8);
+	assert_inteq(json_detect_encoding("\xef\xbb\xbf[]", 5),
+	    JSON_ENCODING_UTF8);
+	assert_inteq(json_detect_encoding("", 0), JSON_ENCODING_UTF8);
+	assert_inteq(json_transcode(JSON_ENCODING_UTF8, "\xef\xbb\xbf[1]", 6,
+	    buf, sizeof buf), 4);
+	assert_streq(buf, "[1]");
+
+	/* A size request returns the exact size */
+	assert_inteq(json_transcode(JSON_ENCODING_UTF16LE,
+	    "\xff\xfe{\0\"\0\xe9\0\"\0:\0=\xd8\x00\xde}\0", 18, NULL, 0), 12);
+	assert_inteq(json_transcode(JSON_ENCODING_LATIN1, src, 1, NULL, 0), 2);
+
+	/* A small buffer is an error */
+	assert_errno(json_transcode(JSON_ENCODING_UTF16LE, src, 40,
+	    buf, 20) == 0, ENOMEM);
+	assert_streq(buf, "");
+	assert_errno(json_transcode(JSON_ENCODING_UTF8, "[1]", 3,
+	    buf, 3) == 0, ENOMEM);
+
+	/* Unpaired surrogates, odd lengths and NULs are invalid */
+	assert_errno(json_transcode(JSON_ENCODING_UTF16LE,
+	    "\"\0=\xd8\"\0", 6, buf, sizeof buf) == 0, EINVAL);
+	assert_errno(json_transcode(JSON_ENCODING_UTF16LE,
+	    "\"\0\x00\xde\"\0", 6, buf, sizeof buf) == 0, EINVAL);
+	assert_errno(json_transcode(JSON_ENCODING_UTF16LE, "[\0]", 3,
+	    buf, sizeof buf) == 0, EINVAL);
+	assert_errno(json_transcode(JSON_ENCODING_UTF16LE,
+	    "[\0\0\0]\0", 6, buf, sizeof buf) == 0, EINVAL);
+	memset(src, 0, 16);
+	memcpy(src, "[\0 \0 \0]\0", 8);
+	assert_errno(json_transcode(JSON_ENCODING_UTF16LE, src, 16,
+	    NULL, 0) == 0, EINVAL);
+	assert_errno(json_transcode(JSON_ENCODING_LATIN1, "[\0]", 3,
+	    buf, sizeof buf) == 0, EINVAL);
+	assert_errno(json_transcode(JSON_ENCODING_UTF8, "[\0]", 3,
+	    buf, sizeof buf) == 0, EINVAL);
+	assert_errno(json_transcode(99, "[]", 2, buf, sizeof buf) == 0,
+	    EINVAL);
+
+	return 0;
+}
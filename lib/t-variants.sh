@@ -0,0 +1,17 @@
+#!/bin/sh
+# Runs each test program again with each variant of the CPU kernels.
+# Variants that this CPU lacks fall back to the best one it has.
+
+if [ -z "$CHECK_PROGRAMS" ]; then
+	echo "CHECK_PROGRAMS is not set"
+	exit 99
+fi
+
+for cpu in scalar swar sse2 avx2 avx512; do
+	for t in $CHECK_PROGRAMS; do
+		if ! REDJSON_CPU=$cpu ./$t >/dev/null 2>&1; then
+			echo "FAIL: $t with REDJSON_CPU=$cpu"
+			exit 1
+		fi
+	done
+done
@@ -0,0 +1,204 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "private.h"
+
+/* The kinds of template segment */
+enum op_type {
+	OP_TEXT,		/* constant text */
+	OP_INT,			/* %d */
+	OP_LONG,		/* %ld */
+	OP_DOUBLE,		/* %f */
+	OP_STR,			/* %s */
+	OP_RAW			/* %raw */
+};
+
+/* A segment of a compiled template */
+struct op {
+	enum op_type type;
+	size_t off, len;	/* the constant text, for OP_TEXT */
+};
+
+struct json_template {
+	struct op *ops;
+	size_t nops;
+	char *text;		/* the constant text of all segments */
+};
+
+__PUBLIC
+struct json_template *
+json_template_compile(const char *fmt)
+{
+	struct json_template *tpl;
+	size_t maxops = 1;
+	struct op *last_text = NULL;
+	const char *f;
+	char *text;
+
+	if (!fmt) {
+		errno = EINVAL;
+		return NULL;
+	}
+	/* Each conversion adds at most a slot and a text segment */
+	for (f = fmt; (f = strchr(f, '%')); f++)
+		maxops += 2;
+
+	tpl = calloc(1, sizeof *tpl);
+	if (!tpl)
+		return NULL;
+	tpl->ops = malloc(maxops * sizeof *tpl->ops);
+	tpl->text = malloc(strlen(fmt) + 1);
+	if (!tpl->ops || !tpl->text)
+		goto fail;
+
+	text = tpl->text;
+	f = fmt;
+	while (*f) {
+		struct op *op = tpl->ops + tpl->nops;
+		size_t n = strcspn(f, "%");
+
+		if (n || (f[0] == '%' && f[1] == '%')) {
+			/* Constant text, with %% as a literal % */
+			if (!n)
+				n = 1, f++;
+			if (last_text)
+				last_text->len += n;
+			else {
+				op->type = OP_TEXT;
+				op->off = text - tpl->text;
+				op->len = n;
+				last_text = op;
+				tpl->nops++;
+			}
+			memcpy(text, f, n);
+			text += n;
+			f += n;
+			continue;
+		}
+		f++;
+		if (*f == 'd')
+			op->type = OP_INT, f += 1;
+		else if (strncmp(f, "ld", 2) == 0)
+			op->type = OP_LONG, f += 2;
+		else if (*f == 'f')
+			op->type = OP_DOUBLE, f += 1;
+		else if (*f == 's')
+			op->type = OP_STR, f += 1;
+		else if (strncmp(f, "raw", 3) == 0)
+			op->type = OP_RAW, f += 3;
+		else {
+			errno = EINVAL;
+			goto fail;
+		}
+		last_text = NULL;
+		tpl->nops++;
+	}
+	return tpl;
+fail:
+	json_template_free(tpl);
+	return NULL;
+}
+
+__PUBLIC
+void
+json_template_free(struct json_template *tpl)
+{
+	if (!tpl)
+		return;
+	free(tpl->ops);
+	free(tpl->text);
+	free(tpl);
+}
+
+__PUBLIC
+size_t
+json_template_vrender(const struct json_template *tpl,
+	__JSON char *dst, size_t dstsz, va_list ap)
+{
+	size_t outlen = 0;
+	size_t i;
+
+	for (i = 0; i < tpl->nops; i++) {
+		const struct op *op = &tpl->ops[i];
+		char num[FORMAT_NUMBER_SZ];
+		const char *seg = NULL;
+		const char *s;
+		size_t n = 0;
+
+		switch (op->type) {
+		case OP_TEXT:
+			seg = tpl->text + op->off;
+			n = op->len;
+			break;
+		case OP_INT:
+			seg = num;
+			n = format_int64(va_arg(ap, int), num);
+			break;
+		case OP_LONG:
+			seg = num;
+			n = format_int64(va_arg(ap, long), num);
+			break;
+		case OP_DOUBLE:
+			seg = num;
+			n = format_double(va_arg(ap, double), num);
+			if (!n)
+				goto fail;
+			break;
+		case OP_RAW:
+			seg = va_arg(ap, const char *);
+			if (!seg)
+				seg = json_null;
+			n = strlen(seg);
+			break;
+		case OP_STR:
+			s = va_arg(ap, const char *);
+			if (!s) {
+				seg = json_null;
+				n = 4;
+				break;
+			}
+			/* Escape directly into the output */
+			if (!dstsz)
+				n = json_from_str(s, NULL, 0);
+			else
+				n = json_from_str(s, dst + outlen,
+				    dstsz - outlen);
+			if (!n)
+				goto fail;
+			outlen += n - 1;
+			continue;
+		}
+		if (dstsz) {
+			/* Leave room for the NUL */
+			if (n >= dstsz - outlen) {
+				errno = ENOMEM;
+				goto fail;
+			}
+			memcpy(dst + outlen, seg, n);
+		}
+		outlen += n;
+	}
+	if (dstsz)
+		dst[outlen] = '\0';
+	return outlen + 1;
+fail:
+	if (dstsz)
+		*dst = '\0';
+	return 0;
+}
+
+__PUBLIC
+size_t
+json_template_render(const struct json_template *tpl,
+	__JSON char *dst, size_t dstsz, ...)
+{
+	va_list ap;
+	size_t ret;
+
+	va_start(ap, dstsz);
+	ret = json_template_vrender(tpl, dst, dstsz, ap);
+	va_end(ap);
+	return ret;
+}
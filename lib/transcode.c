@@ -0,0 +1,210 @@
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "private.h"
+#include "utf8.h"
+
+/* Byte masks that are zero on ASCII-only UTF-16 code units,
+ * in memory order. They are loaded with memcpy() so the host's byte
+ * order does not matter. */
+static const unsigned char utf16le_ascii_mask[8] = {
+	0x80, 0xff, 0x80, 0xff, 0x80, 0xff, 0x80, 0xff
+};
+static const unsigned char utf16be_ascii_mask[8] = {
+	0xff, 0x80, 0xff, 0x80, 0xff, 0x80, 0xff, 0x80
+};
+
+/** Tests if the next 8 bytes, under a mask, are all zero */
+static int
+masked_zero(const unsigned char *p, const unsigned char *mask)
+{
+	uint64_t word, m;
+
+	memcpy(&word, p, sizeof word);
+	memcpy(&m, mask, sizeof m);
+	return (word & m) == 0;
+}
+
+/* No stop characters for #ascii_span() */
+static const char no_stops[4];
+
+/** Tests if the first bytes of the source begin with a byte sequence */
+static int
+starts_with(const unsigned char *p, size_t len, const char *seq,
+	size_t seqlen)
+{
+	return len >= seqlen && memcmp(p, seq, seqlen) == 0;
+}
+
+/**
+ * Tests if a buffer is entirely valid UTF-8.
+ * Runs of ASCII are skipped with #ascii_span().
+ */
+static int
+is_utf8(const unsigned char *p, size_t len)
+{
+	const unsigned char *end = p + len;
+
+	while (p < end) {
+		ucode u;
+		size_t n;
+
+		n = ascii_span((const char *)p, end - p, no_stops);
+		if (n) {
+			p += n;
+			continue;
+		}
+		n = get_utf8_raw_bounded((const char *)p, (const char *)end,
+		    &u);
+		if (!n || !IS_UTF8_SAFE(u))
+			return 0;
+		p += n;
+	}
+	return 1;
+}
+
+__PUBLIC
+enum json_encoding
+json_detect_encoding(const void *src, size_t srcsz)
+{
+	const unsigned char *p = src;
+
+	if (starts_with(p, srcsz, "\xef\xbb\xbf", 3))
+		return JSON_ENCODING_UTF8;
+	if (starts_with(p, srcsz, "\xff\xfe", 2))
+		return JSON_ENCODING_UTF16LE;
+	if (starts_with(p, srcsz, "\xfe\xff", 2))
+		return JSON_ENCODING_UTF16BE;
+
+	/* JSON text begins with an ASCII character, which in UTF-16
+	 * has a zero byte beside it (RFC 4627 section 3) */
+	if (srcsz >= 2 && !p[0] && p[1])
+		return JSON_ENCODING_UTF16BE;
+	if (srcsz >= 2 && p[0] && !p[1])
+		return JSON_ENCODING_UTF16LE;
+
+	if (is_utf8(p, srcsz))
+		return JSON_ENCODING_UTF8;
+	return JSON_ENCODING_LATIN1;
+}
+
+__PUBLIC
+size_t
+json_transcode(enum json_encoding enc, const void *src, size_t srcsz,
+	__JSON char *dst, size_t dstsz)
+{
+	const unsigned char *p = src;
+	const unsigned char *end = p + srcsz;
+	size_t outlen = 0;
+
+#define OUT(ch) do {						\
+		if (outlen < dstsz)				\
+			dst[outlen] = (ch);			\
+		outlen++;					\
+	} while (0)
+
+	switch (enc) {
+	case JSON_ENCODING_UTF8:
+		if (starts_with(p, srcsz, "\xef\xbb\xbf", 3))
+			p += 3;
+		if (memchr(p, '\0', end - p))
+			goto invalid;
+		outlen = end - p;
+		if (outlen < dstsz)
+			memcpy(dst, p, outlen);
+		break;
+
+	case JSON_ENCODING_LATIN1:
+		while (p < end) {
+			unsigned char ch;
+			size_t n;
+
+			/* Copy runs of ASCII whole */
+			n = ascii_span((const char *)p, end - p, no_stops);
+			if (n) {
+				if (outlen + n <= dstsz)
+					memcpy(dst + outlen, p, n);
+				outlen += n;
+				p += n;
+				continue;
+			}
+			ch = *p++;
+			if (!ch)
+				goto invalid;
+			if (ch < 0x80)
+				OUT(ch);
+			else {
+				OUT(0xc0 | (ch >> 6));
+				OUT(0x80 | (ch & 0x3f));
+			}
+		}
+		break;
+
+	case JSON_ENCODING_UTF16LE:
+	case JSON_ENCODING_UTF16BE: {
+		int be = enc == JSON_ENCODING_UTF16BE;
+		const unsigned char *mask = be ? utf16be_ascii_mask
+					       : utf16le_ascii_mask;
+
+		if ((end - p) % 2)
+			goto invalid;
+		if (starts_with(p, srcsz, be ? "\xfe\xff" : "\xff\xfe", 2))
+			p += 2;
+		while (p < end) {
+			char buf[4];
+			ucode u;
+			size_t i, n;
+
+			/* Copy four ASCII code units at a time */
+			if (end - p >= 8 && masked_zero(p, mask) &&
+			    p[be] && p[2 + be] && p[4 + be] && p[6 + be])
+			{
+				if (outlen + 4 <= dstsz)
+					for (i = 0; i < 4; i++)
+						dst[outlen + i] = p[2 * i + be];
+				outlen += 4;
+				p += 8;
+				continue;
+			}
+			u = be ? p[0] << 8 | p[1] : p[1] << 8 | p[0];
+			p += 2;
+			if (IS_SURROGATE_HI(u) && p < end) {
+				ucode lo = be ? p[0] << 8 | p[1]
+					      : p[1] << 8 | p[0];
+				if (IS_SURROGATE_LO(lo)) {
+					u = 0x10000 + ((u & 0x3ff) << 10) +
+					    (lo & 0x3ff);
+					p += 2;
+				}
+			}
+			if (!u || IS_SURROGATE(u))
+				goto invalid; /* NUL or unpaired surrogate */
+			n = put_utf8_raw(u, buf, sizeof buf);
+			for (i = 0; i < n; i++)
+				OUT(buf[i]);
+		}
+		break;
+	}
+
+	default:
+		goto invalid;
+	}
+#undef OUT
+
+	outlen++; /* NUL */
+	if (!dstsz)
+		return outlen;
+	if (outlen > dstsz) {
+		errno = ENOMEM;
+		*dst = '\0';
+		return 0;
+	}
+	dst[outlen - 1] = '\0';
+	return outlen;
+invalid:
+	errno = EINVAL;
+	if (dstsz)
+		*dst = '\0';
+	return 0;
+}
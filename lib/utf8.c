@@ -147,6 +147,72 @@ put_utf8_raw(ucode u, void *buf, int bufsz)
 #	undef OUT
 }
 
+/**
+ * Measures a run of text that needs no per-character conversion.
+ *
+ * The run is valid shortest-form UTF-8 of code points in the
+ * Unicode Scalar Value range, excluding control characters and the
+ * ASCII characters in @a stops. Sanitizing such a run with
+ * #get_utf8_sanitized() and re-encoding it with #put_sanitized_utf8()
+ * reproduces the same bytes, so callers can copy it as a whole.
+ *
+ * ASCII is checked with #ascii_span() when the end of the text is
+ * known or the text is padded, and otherwise a byte at a time.
+ * Other bytes are decoded as whole sequences and only checked for
+ * validity.
+ *
+ * @param p      the text
+ * @param p_end  end of the text, or @c NULL if the text is
+ *               NUL-terminated. Data at @a p_end will not be accessed.
+ * @param stops  up to four ASCII characters that end the run
+ * @param padded nonzero if @a p_end is @c NULL and #JSON_PADDING bytes
+ *               after the NUL terminator are readable
+ *
+ * @returns the length of the run in bytes, which may be 0
+ */
+size_t
+span_utf8(const char *p, const char *p_end, const char *stops, int padded)
+{
+	const char *start = p;
+	char stop[4] = { 0, 0, 0, 0 };	/* NUL is a control anyway */
+	size_t i;
+
+	for (i = 0; i < 4 && stops[i]; i++)
+		stop[i] = stops[i];
+
+	while (p != p_end) {
+		unsigned char ch = *p;
+		size_t n;
+		ucode u;
+
+		if (ch < 0x80) {
+			if (p_end || padded) {
+				/* Padded reads past the NUL are harmless,
+				 * because the NUL ends the run */
+				n = ascii_span(p, p_end ? (size_t)(p_end - p)
+				    : JSON_PADDING, stop);
+				if (!n)
+					break;
+				p += n;
+				continue;
+			}
+			if (ch < 0x20 || ch == stop[0] || ch == stop[1] ||
+			    ch == stop[2] || ch == stop[3])
+				break;
+			p++;
+			continue;
+		}
+		if (p_end)
+			n = get_utf8_raw_bounded(p, p_end, &u);
+		else
+			n = get_utf8_raw(p, &u);
+		if (!n || !IS_UTF8_SAFE(u))
+			break;
+		p += n;
+	}
+	return p - start;
+}
+
 /**
  * Consumes a UTF-8 unicode character, sanitizing invalid UTF-8,
  * and otherwise valid encodings from {U+0,U+D800.U+DFFF}.
@@ -23,6 +23,7 @@
 /** @file */
 
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 /* Type qualifiers used to document function signatures */
@@ -36,6 +37,56 @@
 /** Implementation version for the library, eg "1.0" */
 extern const char redjson_lib_version[];
 
+#define JSON_CPU_SSE2    0x1 /**< SSE2 kernels are in use */
+#define JSON_CPU_AVX2    0x2 /**< AVX2 kernels are in use */
+#define JSON_CPU_AVX512  0x4 /**< AVX-512BW kernels are in use */
+
+/**
+ * Reports which vector instructions the library's kernels use.
+ *
+ * The kernels are the scans for runs of plain text and of string
+ * contents, and the encoders of #json_from_hex() and
+ * #json_from_bytes(). They are chosen once, from the best
+ * instructions this CPU supports. For testing, the environment
+ * variable @c REDJSON_CPU can name a lesser variant: @c scalar,
+ * @c swar (portable 64-bit words), @c sse2, @c avx2 or @c avx512.
+ *
+ * @returns a bitmask of @c JSON_CPU_* flags, which is 0 when the
+ *          portable kernels are in use
+ */
+unsigned json_cpu_features(void);
+
+#define JSON_ALLOC_HUGE_PAGES 0x1 /**< Advise transparent huge pages */
+#define JSON_ALLOC_HUGETLB    0x2 /**< Try reserved huge pages first */
+#define JSON_ALLOC_LOCAL      0x4 /**< Place pages on the caller's node */
+
+/**
+ * Sets how the library allocates large working memory.
+ *
+ * This affects blocks of 2 MiB or more that the library allocates
+ * for itself: the offsets of #json_object_sorted_index(), the strings
+ * of #json_as_str_array() and the hash slots of #json_intern_add().
+ * With a policy of 0, the default, they come from @c malloc().
+ * Otherwise, on Linux, they are mapped separately, and
+ * <ul>
+ * <li>#JSON_ALLOC_HUGE_PAGES aligns them to 2 MiB and advises the
+ *     kernel to back them with transparent huge pages, which reduces
+ *     TLB misses when they are searched;
+ * <li>#JSON_ALLOC_HUGETLB first tries the reserved huge pages of
+ *     @c MAP_HUGETLB, falling back to the above when none are free;
+ * <li>#JSON_ALLOC_LOCAL binds them to the NUMA node of the thread that
+ *     allocates them, and faults them in at once. Build each index on
+ *     a thread that runs on the node where it will be used.
+ * </ul>
+ *
+ * The policy is global. Set it before other threads use the library.
+ *
+ * @param policy  a bitmask of @c JSON_ALLOC_* flags
+ *
+ * @returns the previous policy
+ */
+unsigned json_set_alloc_policy(unsigned policy);
+
 /**
  * Selects an element within a JSON structure.
  *
@@ -86,6 +137,151 @@ const __JSON char *json_select(const __JSON char *json, const char *path, ...)
 const __JSON char *json_selectv(const __JSON char *json, const char *path,
     va_list ap);
 
+/**
+ * Selects an element within a JSON structure, ignoring the case of keys.
+ *
+ * This is the same as #json_select(), except that keys match when
+ * they are equal after Unicode simple case folding, so that the path
+ * "userId" selects a member keyed "UserID" or "userid".
+ * The first matching member is selected.
+ *
+ * ASCII is folded quickly. Other letters are folded when they are
+ * from the Latin, Greek, Cyrillic or Armenian scripts, or are fullwidth
+ * Latin letters; other characters must match exactly.
+ *
+ * @param json  (optional) JSON value to select within
+ * @param path  selection path, see #json_select()
+ * @param ...   Respective arguments for each <code>.%s</code> and
+ *              <code>[%u]</code> component of the @a path
+ *
+ * @returns pointer within @a json to the selected value
+ * @retval  NULL  [ENOENT] The path was not found in the value.
+ * @retval  NULL  [ENOMEM] The input is too deeply nested.
+ * @retval  NULL  [EINVAL] The path is malformed.
+ */
+const __JSON char *json_iselect(const __JSON char *json, const char *path, ...)
+    __attribute__((format(printf,2,3)));
+
+/** @see #json_iselect() */
+const __JSON char *json_iselectv(const __JSON char *json, const char *path,
+    va_list ap);
+
+/**
+ * Selects the same path within each of many JSON values.
+ *
+ * This is equivalent to calling #json_select() on each document,
+ * but is faster for large numbers of small documents, because
+ * the path is parsed once per group of documents, and the scans of
+ * the documents in each group are interleaved a member or element at
+ * a time, so that their memory accesses can overlap.
+ *
+ * The selection path has the same form as for #json_select(),
+ * except that argument references (such as <code>.%s</code>)
+ * are not permitted.
+ *
+ * @param docs  array of (optional) JSON values to select within
+ * @param n     number of elements in @a docs and @a out
+ * @param path  selection path, matches <code>(.key|[int])*</code>
+ * @param out   storage for the selected values, in the same order as
+ *              @a docs. Where a selection fails, @c NULL is stored.
+ *
+ * @returns the number of non-NULL values stored in @a out
+ * @retval 0 [EINVAL] The path is malformed.
+ */
+size_t json_select_batch(const __JSON char *const docs[], size_t n,
+	const char *path, const __JSON char *out[]);
+
+/**
+ * State of a selection that can resume as more JSON text arrives.
+ *
+ * The members are private.
+ * Initialize this structure with #json_selector_init().
+ */
+struct json_selector {
+	const char *path;	/**< unparsed remainder of the path */
+	const char *key;	/**< key being sought in an object */
+	size_t keylen;		/**< length of the key being sought */
+	unsigned index;		/**< array elements still to be skipped */
+	size_t offset;		/**< offset into the text to resume from */
+	int state;		/**< kind of text found at the offset */
+	int first;		/**< the path is at its first component */
+	size_t value;		/**< offset of an unwanted member's value */
+	size_t scan;		/**< offset to resume skipping a value from */
+	size_t depth;		/**< nesting depth within the skipped value */
+	int skip;		/**< progress of the skip */
+	char quote;		/**< quote of the string being skipped, or 0 */
+	char escape;		/**< a backslash is pending in that string */
+	unsigned char nest[128]; /**< 1 bits for open arrays, 0 for objects */
+};
+
+/**
+ * Prepares a selection over JSON text that is still being received.
+ *
+ * The selection path has the same form as for #json_select(),
+ * except that argument references (such as <code>.%s</code>)
+ * are not permitted.
+ *
+ * @param sel   storage for the selection state
+ * @param path  selection path, matches <code>(.key|[int])*</code>.
+ *              It must remain valid while the selector is in use.
+ */
+void json_selector_init(struct json_selector *sel, const char *path);
+
+/**
+ * Continues a selection after more JSON text has arrived.
+ *
+ * The JSON text is the whole of the text received so far.
+ * It must be NUL-terminated, and each call must be given text that
+ * begins with the text from the previous call.
+ * The text may have been moved (eg by @c realloc()) between calls,
+ * since the selector only remembers offsets into it.
+ *
+ * Each call resumes scanning where the previous call stopped, so
+ * the total work is proportional to the length of the text however
+ * it is divided. A value is known to be complete once some other
+ * text follows it. Values skipped over may be nested 1024 deep.
+ * Once the text is complete, use #json_selector_finish() instead.
+ *
+ * Example usage:
+ *
+ * @code
+ *     struct json_selector sel;
+ *
+ *     json_selector_init(&sel, "user.id");
+ *     while (!(id = json_selector_resume(&sel, body)) && errno == EAGAIN)
+ *         body = receive_more(body);
+ * @endcode
+ *
+ * @param sel   the selection state, from #json_selector_init()
+ * @param json  (optional) JSON text received so far
+ *
+ * @returns pointer within @a json to the selected value
+ * @retval NULL [EAGAIN] More text is needed to continue the selection.
+ * @retval NULL [ENOENT] The path was not found in the value.
+ * @retval NULL [ENOMEM] The input is too deeply nested.
+ * @retval NULL [EINVAL] The path or JSON text is malformed.
+ */
+const __JSON char *json_selector_resume(struct json_selector *sel,
+	const __JSON char *json);
+
+/**
+ * Completes a selection after the last JSON text has arrived.
+ *
+ * This is the same as #json_selector_resume(), except that
+ * the end of the text is treated as the end of the input,
+ * and so it never fails with @c EAGAIN.
+ *
+ * @param sel   the selection state, from #json_selector_init()
+ * @param json  (optional) the complete JSON text
+ *
+ * @returns pointer within @a json to the selected value
+ * @retval NULL [ENOENT] The path was not found in the value.
+ * @retval NULL [ENOMEM] The input is too deeply nested.
+ * @retval NULL [EINVAL] The path or JSON text is malformed.
+ */
+const __JSON char *json_selector_finish(struct json_selector *sel,
+	const __JSON char *json);
+
 /* Convenience macros */
 #define json_select_int(...)    json_as_int(json_select(__VA_ARGS__))
 #define json_select_bool(...)   json_as_bool(json_select(__VA_ARGS__))
@@ -150,6 +346,91 @@ const __JSON_ARRAYI char *json_as_array(const __JSON char *json);
  */
 const __JSON char *json_array_next(const __JSON_ARRAYI char **index_ptr);
 
+/** Flags selecting the results wanted from #json_array_reduce_double() */
+#define JSON_REDUCE_SUM  0x1	/**< Sum of the numbers */
+#define JSON_REDUCE_MIN  0x2	/**< Smallest number */
+#define JSON_REDUCE_MAX  0x4	/**< Largest number */
+#define JSON_REDUCE_MEAN 0x8	/**< Arithmetic mean of the numbers */
+
+/** Results of reducing an array with #json_array_reduce_double() */
+struct json_reduce {
+	size_t count;	/**< Number of elements that were numbers */
+	size_t skipped;	/**< Number of elements that were not numbers */
+	double sum;	/**< Sum, or NaN if not requested */
+	double min;	/**< Minimum, or NaN if not requested or no numbers */
+	double max;	/**< Maximum, or NaN if not requested or no numbers */
+	double mean;	/**< Mean, or NaN if not requested or no numbers */
+};
+
+/**
+ * Summarizes the numbers in a JSON array.
+ *
+ * Each element is converted as it is scanned, so the array text
+ * is only traversed once.
+ * This is faster than converting the elements found by
+ * #json_array_next() with #json_as_double().
+ *
+ * Only elements that are strictly JSON numbers are reduced.
+ * Other elements (including quoted numbers) are counted and
+ * otherwise ignored.
+ *
+ * @param json  (optional) JSON array text
+ * @param flags bitwise OR of #JSON_REDUCE_SUM, #JSON_REDUCE_MIN,
+ *              #JSON_REDUCE_MAX and #JSON_REDUCE_MEAN, selecting
+ *              which results are to be stored
+ * @param out   storage for the results
+ *
+ * @retval 0 The reduction results were stored in @a out.
+ * @retval -1 [EINVAL] The value is not an array, or is malformed.
+ * @retval -1 [ENOMEM] An element is too deeply nested.
+ */
+int json_array_reduce_double(const __JSON char *json, int flags,
+	struct json_reduce *out);
+
+/**
+ * Converts a JSON array of numbers into an array of floats.
+ *
+ * Each element is converted as by #json_as_float(), but in a single
+ * pass over the array text.
+ * Elements that are not strict JSON numbers are stored as their
+ * #json_as_float() conversion (usually NaN), and cause @c errno
+ * to be set to @c EINVAL after all elements have been stored.
+ *
+ * The number of elements in the array can be obtained by calling
+ * this function with a zero-sized output buffer.
+ *
+ * @param json  (optional) JSON array text
+ * @param dst   (optional) output storage for the converted elements
+ * @param dstsz the number of floats that @a dst can hold, or
+ *              0 to request the number of elements
+ *
+ * @returns the number of elements stored in @a dst, or
+ *          the number of elements in the array when @a dstsz is 0
+ * @retval 0 [EINVAL] The value is not an array, or is malformed.
+ * @retval 0 [ENOMEM] The array has more than @a dstsz elements.
+ *                    The first @a dstsz elements were stored.
+ * @retval 0 The array is empty.
+ */
+size_t json_as_float_array(const __JSON char *json, float *dst,
+	size_t dstsz);
+
+/**
+ * Counts the elements of a JSON array.
+ *
+ * This is much faster than counting with #json_array_next(),
+ * because it scans the array text once, without separately
+ * skipping over each element.
+ * The count agrees with #json_array_next() for well-formed arrays,
+ * including those with a trailing comma.
+ * The elements themselves are not validated.
+ *
+ * @param json  (optional) JSON array text
+ *
+ * @returns the number of elements in the array
+ * @retval -1 [EINVAL] The value is not an array, or is unterminated.
+ */
+long json_array_length(const __JSON char *json);
+
 /**
  * Begins iterating over a JSON object.
  *
@@ -190,6 +471,543 @@ const __JSON_OBJECTI char *json_as_object(const __JSON char *json);
 const __JSON char *json_object_next(const __JSON_OBJECTI char **index_ptr,
 		const __JSON char **key_return);
 
+/**
+ * Counts the members of a JSON object.
+ *
+ * This is the object equivalent of #json_array_length().
+ *
+ * @param json  (optional) JSON object text
+ *
+ * @returns the number of key-value pairs in the object
+ * @retval -1 [EINVAL] The value is not an object, or is unterminated.
+ */
+long json_object_size(const __JSON char *json);
+
+/**
+ * A Bloom filter of the keys of one JSON object.
+ *
+ * The filter is owned by the caller, who typically keeps it
+ * alongside the object text it was built from.
+ * It answers "definitely absent" for most missing keys
+ * without scanning the object.
+ *
+ * The filter has a fixed 512 bits, so it suits objects of up to
+ * about 100 keys. Absent keys pass it about 1 time in 60 for
+ * 50 keys, 1 in 11 for 100 keys, 1 in 3 for 200 keys, and almost
+ * always beyond 500 keys. For larger objects, use a
+ * #json_object_sorted_index() instead.
+ */
+struct json_key_filter {
+	const __JSON char *object; /**< The object text described */
+	uint64_t bits[8];	/**< 512-bit filter of hashed keys */
+};
+
+/**
+ * Builds a key filter for a JSON object.
+ *
+ * This scans the object once. The object text must not change
+ * while the filter is in use.
+ *
+ * @param f     the filter to initialize
+ * @param json  (optional) JSON object text
+ *
+ * @retval 0 The filter was built.
+ * @retval -1 [EINVAL] The value is not an object, or is malformed.
+ * @retval -1 [ENOMEM] A member is too deeply nested.
+ */
+int json_key_filter_init(struct json_key_filter *f,
+	const __JSON char *json);
+
+/**
+ * Tests if a key may be in the object.
+ *
+ * False positives happen, but false negatives do not.
+ * For an object with 50 keys, about 1 in 60 absent keys
+ * gives a false positive.
+ *
+ * @param f    a filter from #json_key_filter_init()
+ * @param key  a UTF-8 key, compared as by #json_strcmp()
+ *
+ * @retval 0 The key is definitely not in the object.
+ * @retval 1 The key may be in the object.
+ */
+int json_key_filter_test(const struct json_key_filter *f, const char *key);
+
+/**
+ * Finds a member of the object, using its key filter.
+ *
+ * This returns the same as <code>json_select(f->object, "%s", key)</code>,
+ * but keys that the filter excludes are not searched for.
+ *
+ * @param f    a filter from #json_key_filter_init()
+ * @param key  a UTF-8 key
+ *
+ * @returns pointer within the object text to the value of @a key
+ * @retval NULL [ENOENT] The key is not in the object.
+ * @retval NULL [EINVAL] The object is malformed.
+ */
+const __JSON char *json_key_filter_get(const struct json_key_filter *f,
+	const char *key);
+
+/**
+ * An index of the members of a JSON object, sorted by key.
+ *
+ * Each member is stored as a pair of offsets into the object text:
+ * the offset of its key, and the offset of its value.
+ */
+struct json_sorted_index {
+	const __JSON char *object; /**< The object text indexed */
+	size_t count;		/**< Number of members */
+	uint32_t *offsets;	/**< Key and value offsets of each member */
+};
+
+/**
+ * Builds a sorted index of the members of a JSON object.
+ *
+ * Members are sorted by their decoded keys in Unicode code point
+ * order, which is the order used by #json_strcmpn() for strings.
+ * Members with equal keys keep the order they have in the object.
+ *
+ * The object text must not change while the index is in use,
+ * and it must be smaller than 4 GiB.
+ *
+ * @param json  (optional) JSON object text
+ * @param idx   storage for the index, which must later
+ *              be released with #json_sorted_index_free()
+ *
+ * @retval 0 The index was built.
+ * @retval -1 [EINVAL] The value is not an object, or is malformed.
+ * @retval -1 [ENOMEM] Allocation failed.
+ * @retval -1 [EOVERFLOW] The object is too large for the index.
+ */
+int json_object_sorted_index(const __JSON char *json,
+	struct json_sorted_index *idx);
+
+/**
+ * Releases the storage of a sorted index.
+ *
+ * @param idx  the index built by #json_object_sorted_index()
+ */
+void json_sorted_index_free(struct json_sorted_index *idx);
+
+/**
+ * Finds a member by binary search of a sorted index.
+ *
+ * If the key occurs more than once, the first occurrence is found,
+ * as #json_select() would.
+ *
+ * @param idx  the sorted index
+ * @param key  a UTF-8 key
+ *
+ * @returns pointer within the object text to the value of @a key
+ * @retval NULL [ENOENT] The key is not in the object.
+ */
+const __JSON char *json_sorted_index_get(const struct json_sorted_index *idx,
+	const char *key);
+
+/**
+ * Finds the range of members whose keys start with a prefix.
+ *
+ * For example, this prints all the values whose keys
+ * start with <code>"user:42:"</code>:
+ *
+ * <code><pre>
+ *     size_t i, first, n;
+ *     n = json_sorted_index_prefix(&idx, "user:42:", &first);
+ *     for (i = first; i < first + n; i++)
+ *         printf("%d\n", json_as_int(json_sorted_index_value(&idx, i)));
+ * </pre></code>
+ *
+ * @param idx           the sorted index
+ * @param prefix        a UTF-8 key prefix; the empty string matches all keys
+ * @param first_return  (optional) storage for the position of the first
+ *                      matching member
+ *
+ * @returns the number of members whose keys start with @a prefix
+ */
+size_t json_sorted_index_prefix(const struct json_sorted_index *idx,
+	const char *prefix, size_t *first_return);
+
+/**
+ * Returns the key of the <i>i</i>th member of a sorted index.
+ *
+ * @param idx  the sorted index
+ * @param i    the member's position, less than @c idx->count
+ *
+ * @returns pointer within the object text to the member's key
+ */
+const __JSON char *json_sorted_index_key(const struct json_sorted_index *idx,
+	size_t i);
+
+/**
+ * Returns the value of the <i>i</i>th member of a sorted index.
+ *
+ * @param idx  the sorted index
+ * @param i    the member's position, less than @c idx->count
+ *
+ * @returns pointer within the object text to the member's value
+ */
+const __JSON char *json_sorted_index_value(
+	const struct json_sorted_index *idx, size_t i);
+
+/**
+ * Builds a position-independent image of a document and its index.
+ *
+ * An image holds a copy of the document's text and, for every object
+ * and array in it, a table of its members. Objects are sorted by key,
+ * as by #json_object_sorted_index(). The image refers to itself only
+ * by offsets, so it can be built once into shared memory (for example
+ * a @c MAP_SHARED mapping of a file or of @c shm_open()) and queried
+ * with #json_image_select() by every process that maps it, at any
+ * address, without re-indexing.
+ *
+ * The generation is stored last, with release ordering, so a process
+ * that sees it also sees the complete image. To replace a published
+ * document, build the new image into a separate area, then atomically
+ * store its location where readers look for it. An image must not be
+ * rebuilt in place while any process may still be reading it.
+ *
+ * @param json        JSON text, smaller than 4 GiB
+ * @param generation  a nonzero version number, see #json_image_generation()
+ * @param dst         storage for the image, aligned to 8 bytes
+ * @param dstsz       size of @a dst, or 0 to only compute the size.
+ *                    To allocate the image, see #json_image_new().
+ *
+ * @returns the size of the image
+ * @retval 0 [ENOMEM] @a dstsz is too small, or allocation failed.
+ * @retval 0 [EINVAL] The JSON text is malformed, @a generation is 0,
+ *                    or @a dst is misaligned.
+ * @retval 0 [EOVERFLOW] The image would be 4 GiB or larger.
+ */
+size_t json_image_build(const __JSON char *json, uint64_t generation,
+	void *dst, size_t dstsz);
+
+/**
+ * Builds an image into new storage.
+ *
+ * This is #json_image_build() into an allocation of exactly the
+ * image's size, without first building to compute that size.
+ *
+ * @param json        JSON text, smaller than 4 GiB
+ * @param generation  a nonzero version number, see #json_image_generation()
+ *
+ * @returns the image, to be freed with @c free()
+ * @retval NULL [ENOMEM] Allocation failed.
+ * @retval NULL [EINVAL] The JSON text is malformed, or @a generation
+ *                       is 0.
+ * @retval NULL [EOVERFLOW] The image would be 4 GiB or larger.
+ */
+void *json_image_new(const __JSON char *json, uint64_t generation);
+
+/**
+ * Returns the generation of a published image.
+ *
+ * @param image  an image built by #json_image_build()
+ *
+ * @returns the generation given to #json_image_build()
+ * @retval 0 [EINVAL] @a image is not a published image.
+ */
+uint64_t json_image_generation(const void *image);
+
+/**
+ * Selects an element within an image's document.
+ *
+ * This selects the same value as #json_select() would from the
+ * document, but each path component is found in the image's index:
+ * by binary search of an object's keys, or directly for an array
+ * index. The image is never modified, so any number of threads and
+ * processes may select from it at once.
+ *
+ * @param image  an image built by #json_image_build()
+ * @param path   selection path, see #json_select()
+ * @param ...    Respective arguments for each <code>.%s</code>,
+ *               <code>[%d]</code> and <code>[%u]</code> component
+ *               of the @a path
+ *
+ * @returns pointer within the image to the selected value
+ * @retval NULL [ENOENT] The path was not found in the document.
+ * @retval NULL [EINVAL] The path is malformed, or @a image is not a
+ *                       published image.
+ */
+const __JSON char *json_image_select(const void *image,
+	const char *path, ...)
+    __attribute__((format(printf,2,3)));
+
+/** @see #json_image_select() */
+const __JSON char *json_image_selectv(const void *image,
+	const char *path, va_list ap);
+
+/** A cache of document images (opaque) */
+struct json_image_cache;
+
+/**
+ * Creates a cache of document images, keyed by document content.
+ *
+ * A server that sees the same large documents repeatedly can fetch
+ * their images with #json_image_cache_get() instead of indexing each
+ * copy it receives. Lookups of cached documents take no lock, so any
+ * number of threads may share the cache. The cache holds at most
+ * 1024 documents.
+ *
+ * @param budget  the most memory, in bytes, that cached images may use
+ *
+ * @returns a new cache, to be freed with #json_image_cache_free()
+ * @retval NULL [ENOMEM] Allocation failed.
+ */
+struct json_image_cache *json_image_cache_new(size_t budget);
+
+/**
+ * Releases a cache and its images.
+ *
+ * Every image obtained from the cache must have been released.
+ *
+ * @param cache  (optional) the cache
+ */
+void json_image_cache_free(struct json_image_cache *cache);
+
+/**
+ * Finds or builds the image of a document.
+ *
+ * The document is identified by a hash of its text, confirmed by
+ * comparing the text; trailing whitespace is ignored. Text that has
+ * anything else after the value is never cached. If it is not cached, its image is built with
+ * #json_image_build() and added to the cache. To stay within the
+ * budget, images that are not in use are evicted by the CLOCK
+ * algorithm, which keeps recently used images. When there is no
+ * room, the image is still returned, but is not cached.
+ *
+ * The image stays valid until it is released with
+ * #json_image_cache_release(). Select from it with
+ * #json_image_select().
+ *
+ * @param cache  the cache
+ * @param json   JSON text
+ *
+ * @returns the document's image
+ * @retval NULL [EINVAL] The JSON text is malformed.
+ * @retval NULL [ENOMEM] Allocation failed.
+ * @retval NULL [EOVERFLOW] The image would be 4 GiB or larger.
+ */
+const void *json_image_cache_get(struct json_image_cache *cache,
+	const __JSON char *json);
+
+/**
+ * Releases an image obtained from #json_image_cache_get().
+ *
+ * @param cache  the cache
+ * @param image  (optional) the image
+ */
+void json_image_cache_release(struct json_image_cache *cache,
+	const void *image);
+
+/**
+ * Returns the memory used by the images in a cache.
+ *
+ * @param cache  the cache
+ *
+ * @returns bytes charged against the budget, including the cache's
+ *          bookkeeping for each image
+ */
+size_t json_image_cache_size(const struct json_image_cache *cache);
+
+/** A table of interned keys (opaque) */
+struct json_intern;
+
+/**
+ * Creates an empty table of interned keys.
+ *
+ * An intern table maps keys to small integer ids, in the order that
+ * they are added, starting at 0. Object keys can then be recognised
+ * with #json_object_next_id(), and handled with a @c switch on the id
+ * instead of string comparisons.
+ *
+ * The table can be shared by any number of threads, which may add
+ * keys as they meet them while others look keys up. Lookups, and adds
+ * of keys that are already present, never lock or write to the table.
+ * Adds of new keys are serialized by a lock that only they take.
+ * When the hash table grows, the old one is kept until the intern
+ * table is freed, since other threads may still be reading it.
+ *
+ * @returns a new intern table, to be freed with #json_intern_free()
+ * @retval NULL [ENOMEM] Allocation failed.
+ */
+struct json_intern *json_intern_new(void);
+
+/**
+ * Releases an intern table.
+ *
+ * @param t  (optional) the intern table
+ */
+void json_intern_free(struct json_intern *t);
+
+/**
+ * Adds a key to an intern table.
+ *
+ * @param t    the intern table
+ * @param key  a UTF-8 key
+ *
+ * @returns the key's id, which is a new id unless the key
+ *          was already in the table
+ * @retval -1 [ENOMEM] Allocation failed.
+ */
+int json_intern_add(struct json_intern *t, const char *key);
+
+/**
+ * Finds the id of a key in an intern table.
+ *
+ * @param t    the intern table
+ * @param key  a UTF-8 key
+ *
+ * @returns the key's id
+ * @retval -1 [ENOENT] The key has not been added.
+ */
+int json_intern_lookup(const struct json_intern *t, const char *key);
+
+/**
+ * Finds the id of a JSON string in an intern table.
+ *
+ * The string is compared by its decoded content, as by #json_strcmp(),
+ * but it is not copied or decoded into a buffer.
+ *
+ * @param t     the intern table
+ * @param json  (optional) JSON string or word
+ *
+ * @returns the id of the string's content
+ * @retval -1 [ENOENT] The string's content has not been added.
+ * @retval -1 [EINVAL] The value is not a string or word.
+ */
+int json_intern_key_id(const struct json_intern *t,
+	const __JSON char *json);
+
+/**
+ * Returns the key that was interned with an id.
+ *
+ * @param t   the intern table
+ * @param id  the key's id
+ *
+ * @returns the NUL-terminated key, owned by the table
+ * @retval NULL [ENOENT] The id is not in the table.
+ */
+const char *json_intern_name(const struct json_intern *t, int id);
+
+/**
+ * Iterates over an object, returning the id of each member's key.
+ *
+ * This is the same as #json_object_next(), except that the key
+ * is looked up in an intern table instead of being returned.
+ *
+ * <code><pre>
+ *     const char *ji = json_as_object(json);
+ *     const char *value;
+ *     int id;
+ *
+ *     while ((value = json_object_next_id(&ji, keys, &id))) {
+ *         switch (id) {
+ *         case KEY_ID:   ...
+ *         case KEY_NAME: ...
+ *         }
+ *     }
+ * </pre></code>
+ *
+ * @param index_ptr  pointer to an iterator from #json_as_object()
+ * @param t          the intern table
+ * @param id_return  storage for the key's id, or -1 if the key
+ *                   has not been interned
+ *
+ * @returns the member's value
+ * @retval NULL There are no more members, see #json_object_next().
+ */
+const __JSON char *json_object_next_id(const __JSON_OBJECTI char **index_ptr,
+	const struct json_intern *t, int *id_return);
+
+/**
+ * Accesses the next complete record of newline-delimited JSON.
+ * Then advances the record iterator past the record's line.
+ *
+ * Newline-delimited JSON (NDJSON) holds one JSON value per line.
+ * A record is complete only once its terminating newline is present,
+ * so this function can be used to follow text that is still being
+ * appended to, such as a log file.
+ * When no complete record remains, the iterator is left at the start of
+ * the unterminated final line (or at the NUL), and this position can
+ * be remembered as an offset from the start of the text.
+ * After more text has been appended, iteration can resume from that
+ * offset, and only the new bytes will be scanned.
+ *
+ * Example usage:
+ *
+ * @code
+ *     const char *iter = buf + done;
+ *     const char *record;
+ *
+ *     while ((record = json_lines_next(&iter)))
+ *         handle(json_select(record, "level"));
+ *     done = iter - buf;
+ * @endcode
+ *
+ * Blank lines are skipped.
+ * The returned record is not validated.
+ * At the end of input, an unterminated final record is left at the
+ * iterator, where it can still be used directly.
+ *
+ * @param iter_ptr  storage holding the record iterator.
+ *                  It should be initialized to point into
+ *                  NUL-terminated NDJSON text at the start of a line.
+ *
+ * @returns the first non-whitespace byte of the next record
+ * @retval NULL There are no more complete records.
+ * @retval NULL [EAGAIN] An incomplete record is pending at the iterator.
+ */
+const __JSON char *json_lines_next(const __JSON char **iter_ptr);
+
+/** The character encoding of JSON input, see #json_detect_encoding(). */
+enum json_encoding {
+	JSON_ENCODING_UTF8 = 0,	/**< UTF-8, the encoding the library reads */
+	JSON_ENCODING_UTF16LE,	/**< UTF-16, little-endian */
+	JSON_ENCODING_UTF16BE,	/**< UTF-16, big-endian */
+	JSON_ENCODING_LATIN1	/**< ISO-8859-1 */
+};
+
+/**
+ * Guesses the character encoding of JSON input.
+ *
+ * A byte-order mark decides the encoding. Otherwise, a zero byte
+ * beside the first character indicates UTF-16, as JSON text begins
+ * with an ASCII character. Other input is UTF-8 if it is entirely
+ * valid UTF-8, and otherwise is taken to be ISO-8859-1.
+ *
+ * @param src    the input bytes
+ * @param srcsz  the number of bytes in @a src
+ *
+ * @returns the likely encoding of the input
+ */
+enum json_encoding json_detect_encoding(const void *src, size_t srcsz);
+
+/**
+ * Transcodes JSON input into NUL-terminated UTF-8 text.
+ *
+ * The resulting text can be used with all the other functions of
+ * this library. A leading byte-order mark is removed.
+ *
+ * If the @a dstsz is 0, then the exact output buffer size
+ * will be computed and returned.
+ *
+ * @param enc    the encoding of @a src, e.g. from #json_detect_encoding()
+ * @param src    the input bytes
+ * @param srcsz  the number of bytes in @a src
+ * @param dst    output buffer, will be NUL terminated
+ * @param dstsz  output buffer size, or 0 to indicate a size request
+ *
+ * @returns the minimum @a dstsz required (@a dstsz was 0), or
+ *          the number of bytes stored in @a dst including the NUL.
+ * @retval 0 [EINVAL] The input contains a NUL character, an unpaired
+ *                    UTF-16 surrogate, or an odd number of UTF-16 bytes.
+ * @retval 0 [EINVAL] The encoding is unknown.
+ * @retval 0 [ENOMEM] The output buffer is too small.
+ */
+size_t json_transcode(enum json_encoding enc, const void *src, size_t srcsz,
+	__JSON char *dst, size_t dstsz);
+
 /** The type of a JSON value, as guessed by #json_type(). */
 enum json_type {
 	JSON_BAD = 0,	/**< The value is NULL, starts with an
@@ -239,6 +1057,63 @@ enum json_type json_type(const __JSON char *json);
  */
 size_t json_span(const __JSON char *json);
 
+/**
+ * The number of readable bytes that padded input has after its NUL.
+ *
+ * The functions that take padded input, such as #json_span_padded(),
+ * may read up to this many bytes beyond the NUL terminator of the
+ * JSON text, which lets them use whole vector loads without checking
+ * for the end of the text. The content of the padding does not matter.
+ * Use #json_padded_alloc() or #json_padded_strndup() to allocate
+ * suitable buffers.
+ */
+#define JSON_PADDING 64
+
+/**
+ * Allocates a buffer for padded JSON text.
+ *
+ * The buffer has room for @a len bytes of text, followed by a NUL
+ * and #JSON_PADDING bytes of padding, which are set to zero.
+ * The caller stores the text in the first @a len bytes.
+ *
+ * @param len  the length of the text, excluding the NUL
+ *
+ * @returns a pointer to storage allocated by @c malloc(),
+ *          which the caller must release with @c free()
+ * @retval NULL [ENOMEM] Allocation failed.
+ */
+char *json_padded_alloc(size_t len)
+    __attribute__((malloc));
+
+/**
+ * Copies JSON text into a new padded buffer.
+ *
+ * @param src  the text, which need not be NUL-terminated
+ * @param len  the length of the text
+ *
+ * @returns a NUL-terminated copy of @a src, allocated with
+ *          #json_padded_alloc()
+ * @retval NULL [ENOMEM] Allocation failed.
+ */
+char *json_padded_strndup(const char *src, size_t len)
+    __attribute__((malloc));
+
+/**
+ * Determines the span in bytes of a JSON value in padded input.
+ *
+ * This is the same as #json_span(), except that strings are skipped
+ * with vector loads that may read into the padding.
+ *
+ * @param json  (optional) JSON text, followed after its NUL terminator
+ *              by at least #JSON_PADDING readable bytes
+ *
+ * @returns the number of bytes from @a json to just after the end of the
+ *             first value found
+ * @retval 0 [EINVAL] The JSON text is invalid or malformed.
+ * @retval 0 [ENOMEM] The substructure exceeds a nesting limit.
+ */
+size_t json_span_padded(const __JSON char *json);
+
 /**
  * Converts JSON to a floating-point number.
  *
@@ -269,6 +1144,26 @@ size_t json_span(const __JSON char *json);
  */
 double json_as_double(const __JSON char *json);
 
+/**
+ * Converts JSON to a single-precision floating-point number.
+ *
+ * This is the same as #json_as_double() except that the number is
+ * converted directly to a @c float, using @c strtof() where needed.
+ * This is faster, and avoids the double rounding that can happen when
+ * a @c double result is narrowed to @c float.
+ *
+ * @param json pointer to JSON text
+ *
+ * @returns the value converted to a float, and
+ *          @c errno is set to @c EINVAL when the input is not
+ *          a strict a JSON number.
+ * @retval  NAN [EINVAL] The JSON text is invalid or malformed.
+ * @retval  HUGE_VALF [ERANGE] The value is too positive.
+ * @retval -HUGE_VALF [ERANGE] The value is too negative.
+ * @retval  0 [ERANGE] The value is too small and conversion underflowed.
+ */
+float json_as_float(const __JSON char *json);
+
 /**
  * Converts JSON to a long integer.
  *
@@ -316,6 +1211,97 @@ long json_as_long(const __JSON char *json);
  */
 int json_as_int(const __JSON char *json);
 
+/**
+ * Converts JSON to an exactly scaled decimal integer.
+ *
+ * This is intended for quantities such as money that must not be
+ * rounded by a binary floating-point conversion.
+ * The JSON number is converted directly from its decimal digits,
+ * and multiplied by 10<sup>@a scale</sup>.
+ * For example, with a @a scale of 2, <code>12.3</code>
+ * converts to 1230 and <code>-0.05</code> converts to -5.
+ *
+ * Quoted strings containing a strict JSON number
+ * (eg <code>"12.30"</code>) are converted, but set @c errno to @c EINVAL.
+ *
+ * @param json   (optional) JSON text
+ * @param scale  number of decimal places to keep, from 0 to 18
+ *
+ * @returns the number multiplied by 10<sup>@a scale</sup>
+ * @retval 0 [EINVAL] The JSON text is not a number.
+ * @retval 0 [EINVAL] The scale is out of range.
+ * @retval INT64_MIN [ERANGE] The scaled number is too large.
+ * @retval INT64_MAX [ERANGE] The scaled number is too large.
+ * @retval n [ERANGE] The number has more non-zero decimal places
+ *                    than the scale, and was truncated towards zero.
+ */
+int64_t json_as_decimal64(const __JSON char *json, int scale);
+
+/**
+ * Converts a scaled decimal integer into a JSON number.
+ *
+ * This is the reverse of #json_as_decimal64().
+ * Exactly @a scale decimal places are generated, and
+ * at least one digit is placed before the decimal point.
+ * For example, 1230 with a scale of 2 becomes <code>12.30</code>.
+ *
+ * @param value  the number multiplied by 10<sup>@a scale</sup>
+ * @param scale  number of decimal places, from 0 to 18
+ * @param dst    output buffer, will be NUL terminated.
+ * @param dstsz  output buffer size, or 0 to indicate a size request.
+ *               A size of #JSON_FROM_DECIMAL64_SZ is always sufficient.
+ *
+ * @returns the minimum @a dstsz required (@a dstsz was 0), or
+ *          the number of bytes stored in @a dst including the NUL.
+ * @retval 0 [EINVAL] The scale is out of range.
+ * @retval 0 [ENOMEM] The output buffer is too small.
+ */
+size_t json_from_decimal64(int64_t value, int scale,
+	__JSON char *dst, size_t dstsz);
+
+/** Maximum buffer size required by #json_from_decimal64(). */
+#define JSON_FROM_DECIMAL64_SZ (sizeof "-9.223372036854775808")
+
+/**
+ * A decimal floating-point number, with the precision and exponent
+ * range of IEEE 754 decimal128.
+ *
+ * The value represented is
+ * (@a hi &times; 10<sup>17</sup> + @a lo) &times; 10<sup>@a exponent</sup>,
+ * negated if @a negative is set.
+ * The coefficient has up to 34 decimal digits.
+ */
+struct json_decimal128 {
+	int negative;		/**< nonzero if the number is negative */
+	int exponent;		/**< power of ten applied to the coefficient */
+	uint64_t hi;		/**< upper 17 digits of the coefficient */
+	uint64_t lo;		/**< lower 17 digits of the coefficient */
+};
+
+/**
+ * Converts JSON exactly into a decimal floating-point number.
+ *
+ * The number's digits are preserved, including trailing zeros,
+ * so that <code>1.50</code> converts to 150 &times; 10<sup>-2</sup>.
+ * Only an exponent outside the range of decimal128 changes them:
+ * zeros are added to or removed from the end of the coefficient,
+ * as far as that brings the exponent within range.
+ *
+ * Quoted strings containing a strict JSON number
+ * are converted, but set @c errno to @c EINVAL.
+ *
+ * @param json  (optional) JSON text
+ * @param d     storage for the converted number
+ *
+ * @retval 0 The number was converted exactly.
+ * @retval -1 [EINVAL] The JSON text is not a number.
+ * @retval -1 [ERANGE] The number has more than 34 significant digits,
+ *                     and was truncated towards zero.
+ * @retval -1 [ERANGE] The exponent is out of range even so, and was
+ *                     clamped.
+ */
+int json_as_decimal128(const __JSON char *json, struct json_decimal128 *d);
+
 /**
  * Converts JSON to a boolean value.
  *
@@ -405,6 +1391,22 @@ int json_is_null(const __JSON char *json);
  */
 size_t json_as_str(const __JSON char *json, void *buf, size_t bufsz);
 
+/**
+ * Converts padded JSON input into a UTF-8 C string.
+ *
+ * This is the same conversion as #json_as_str(), except that runs of
+ * plain text are measured with vector loads that may read into the
+ * padding.
+ *
+ * @param json  (optional) input JSON text, followed after its NUL
+ *              terminator by at least #JSON_PADDING readable bytes
+ * @param buf   storage for the returned UTF-8 string
+ * @param bufsz the size of @a buf, or 0 if only a return value is wanted
+ *
+ * @returns the minimum buffer size, as for #json_as_str()
+ */
+size_t json_as_str_padded(const __JSON char *json, void *buf, size_t bufsz);
+
 /**
  * Converts JSON into a UTF-8B C string.
  *
@@ -476,6 +1478,42 @@ char *json_as_strdup(const __JSON char *json)
 char *json_as_utf8b_strdup(const __JSON char *json)
     __attribute__((malloc));
 
+/** A packed array of C strings, from #json_as_str_array(). */
+struct json_str_array {
+	char *data;	/**< The NUL-terminated strings, end to end */
+	size_t *offsets;/**< Start of each string in @c data, plus the end */
+	size_t count;	/**< Number of strings */
+};
+
+/**
+ * Converts a JSON array into a packed array of UTF-8 C strings.
+ *
+ * Each element is converted as by #json_as_strdup(), but all of the
+ * strings are stored in the one heap buffer, and the elements are
+ * only scanned once.
+ * The <i>i</i>th string starts at
+ * <code>out->data + out->offsets[i]</code>, and its length
+ * (excluding the NUL) is
+ * <code>out->offsets[i + 1] - out->offsets[i] - 1</code>.
+ *
+ * @param json  (optional) JSON array text
+ * @param out   storage for the packed strings, which must later
+ *              be released with #json_str_array_free()
+ *
+ * @retval 0 The strings were stored in @a out.
+ * @retval -1 [EINVAL] The value is not an array, or is malformed.
+ * @retval -1 [EINVAL] An element could not be converted to a string.
+ * @retval -1 [ENOMEM] Allocation failed.
+ */
+int json_as_str_array(const __JSON char *json, struct json_str_array *out);
+
+/**
+ * Releases the storage of a packed string array.
+ *
+ * @param a  the array filled in by #json_as_str_array()
+ */
+void json_str_array_free(struct json_str_array *a);
+
 /**
  * Decodes BASE-64 JSON string into an array of bytes.
  *
@@ -499,6 +1537,31 @@ char *json_as_utf8b_strdup(const __JSON char *json)
  */
 int json_as_bytes(const __JSON char *json, void *buf, size_t bufsz);
 
+/**
+ * Decodes a hexadecimal JSON string into an array of bytes.
+ *
+ * This is intended for digests and identifiers, such as
+ * <code>"e3b0c442...b855"</code>.
+ * Upper and lower case digits are accepted.
+ * The string must contain an even number of hexadecimal digits
+ * and nothing else; whitespace and escapes are not permitted.
+ *
+ * The output buffer size can be obtained by calling this function
+ * with a zero-sized output buffer size.
+ *
+ * @param json  (optional) input JSON text
+ * @param buf   (optional) output storage for the returned binary data
+ * @param bufsz the size of the output buffer @a buf, or
+ *              0 to request a minimum-size calculation
+ *
+ * @returns the number of bytes successfuly written to @a buf, or
+ *          the minimum output buffer size needed when @a bufsz is 0
+ * @retval -1 [ENOMEM] The buffer size is too small.
+ * @retval -1 [EINVAL] The JSON text is not a valid hexadecimal JSON string.
+ * @retval -1 [EOVERFLOW] The decoded length does not fit in an int.
+ */
+int json_as_hex(const __JSON char *json, void *buf, size_t bufsz);
+
 /**
  * Decode an RFC 3339 string as a time_t.
  *
@@ -575,6 +1638,32 @@ int json_from_bytes(const void *src, size_t srcsz,
  */
 #define JSON_FROM_BYTES_DSTSZ(srcsz)   (3 + (((srcsz) + 2) / 3) * 4)
 
+/**
+ * Encodes binary data into a lowercase hexadecimal, quoted JSON string.
+ *
+ * Use #JSON_FROM_HEX_DSTSZ() to determine the dst buffer size required.
+ *
+ * @param src   source bytes
+ * @param srcsz length of source in bytes
+ * @param dst   output buffer for holding double-quoted JSON string.
+ *              This will be NUL-terminated on success.
+ * @param dstsz size of the output buffer @ dst.
+ *              This must be at least @c JSON_FROM_HEX_DSTSZ(srcsz).
+ *
+ * @returns the number of non-NUL bytes that were stored in @a dst
+ * @retval -1 [ENOMEM] The @a dstsz is too small.
+ */
+int json_from_hex(const void *src, size_t srcsz,
+			      __JSON char *dst, size_t dstsz);
+
+/** Calculates the output buffer size for #json_from_hex().
+ *  @param srcsz length of the source in bytes
+ *  @returns size of a buffer required to hold a NUL-terminated
+ *           JSON string containing the hexadecimal encoding of the
+ *           source bytes.
+ */
+#define JSON_FROM_HEX_DSTSZ(srcsz)     (3 + (srcsz) * 2)
+
 /**
  * Converts a UTF-8 C string into a quoted JSON string.
  *
@@ -658,6 +1747,161 @@ size_t json_from_utf8b(const char *src,
 size_t json_from_utf8bn(const char *src, int srclen,
 				__JSON char *dst, size_t dstsz);
 
+/**
+ * Converts an array of doubles into a JSON array of numbers.
+ *
+ * Each number is written with the fewest significant digits that
+ * convert back to the same double, e.g. <code>[0.1,2,1e-07]</code>.
+ *
+ * If the @a dstsz is 0, then the exact output buffer size
+ * will be computed and returned.
+ * #JSON_FROM_DOUBLE_ARRAY_DSTSZ() is a quicker upper bound.
+ *
+ * @param src   the numbers
+ * @param n     the number of elements in @a src
+ * @param dst   output buffer, will be NUL terminated
+ * @param dstsz output buffer size, or 0 to indicate a size request
+ *
+ * @returns the minimum @a dstsz required (@a dstsz was 0), or
+ *          the number of bytes stored in @a dst including the NUL.
+ * @retval 0 [EINVAL] An element is infinite or NaN.
+ * @retval 0 [ENOMEM] The output buffer is too small.
+ */
+size_t json_from_double_array(const double *src, size_t n,
+				__JSON char *dst, size_t dstsz);
+
+/**
+ * Converts an array of floats into a JSON array of numbers.
+ *
+ * Each number is written with the fewest significant digits that
+ * convert back to the same float, so that <code>0.1f</code> is
+ * written as <code>0.1</code>.
+ *
+ * @see #json_from_double_array()
+ *
+ * @param src   the numbers
+ * @param n     the number of elements in @a src
+ * @param dst   output buffer, will be NUL terminated
+ * @param dstsz output buffer size, or 0 to indicate a size request
+ *
+ * @returns the minimum @a dstsz required (@a dstsz was 0), or
+ *          the number of bytes stored in @a dst including the NUL.
+ * @retval 0 [EINVAL] An element is infinite or NaN.
+ * @retval 0 [ENOMEM] The output buffer is too small.
+ */
+size_t json_from_float_array(const float *src, size_t n,
+				__JSON char *dst, size_t dstsz);
+
+/**
+ * Converts an array of integers into a JSON array of numbers.
+ *
+ * @see #json_from_double_array()
+ *
+ * @param src   the integers
+ * @param n     the number of elements in @a src
+ * @param dst   output buffer, will be NUL terminated
+ * @param dstsz output buffer size, or 0 to indicate a size request
+ *
+ * @returns the minimum @a dstsz required (@a dstsz was 0), or
+ *          the number of bytes stored in @a dst including the NUL.
+ * @retval 0 [ENOMEM] The output buffer is too small.
+ */
+size_t json_from_int64_array(const int64_t *src, size_t n,
+				__JSON char *dst, size_t dstsz);
+
+/** Calculates an output buffer size sufficient for
+ *  #json_from_double_array().
+ *  @param n  the number of elements
+ */
+#define JSON_FROM_DOUBLE_ARRAY_DSTSZ(n) (3 + (n) * 25)
+
+/** Calculates an output buffer size sufficient for
+ *  #json_from_float_array().
+ *  @param n  the number of elements
+ */
+#define JSON_FROM_FLOAT_ARRAY_DSTSZ(n)  (3 + (n) * 18)
+
+/** Calculates an output buffer size sufficient for
+ *  #json_from_int64_array().
+ *  @param n  the number of elements
+ */
+#define JSON_FROM_INT64_ARRAY_DSTSZ(n)  (3 + (n) * 21)
+
+/** A compiled output template (opaque) */
+struct json_template;
+
+/**
+ * Compiles an output template for #json_template_render().
+ *
+ * The template is JSON text containing typed slots that are filled
+ * in when rendering:
+ * <ul>
+ * <li><code>\%d</code> - an @c int
+ * <li><code>\%ld</code> - a @c long
+ * <li><code>\%f</code> - a finite @c double, in the fewest digits
+ *     that convert back to the same value
+ * <li><code>\%s</code> - a UTF-8 C string, converted into a quoted
+ *     JSON string as by #json_from_str(). @c NULL becomes @c null.
+ * <li><code>\%raw</code> - a C string of JSON text, copied as-is.
+ *     @c NULL becomes @c null.
+ * <li><code>\%\%</code> - a literal @c %
+ * </ul>
+ *
+ * The constant text of the template is not checked.
+ *
+ * Example:
+ *
+ *     tpl = json_template_compile("{\"id\":%d,\"name\":%s}");
+ *     json_template_render(tpl, buf, sizeof buf, 7, "Bob");
+ *
+ * @param fmt  the template text
+ *
+ * @returns a template to release with #json_template_free()
+ * @retval NULL [EINVAL] The template contains an unknown slot type,
+ *                       or is @c NULL.
+ * @retval NULL [ENOMEM] Out of memory.
+ */
+struct json_template *json_template_compile(const char *fmt);
+
+/**
+ * Releases a compiled template.
+ *
+ * @param tpl  (optional) template from #json_template_compile()
+ */
+void json_template_free(struct json_template *tpl);
+
+/**
+ * Renders a compiled template, filling its slots from the arguments.
+ *
+ * The constant text is copied as-is, so rendering is much faster
+ * than formatting the same text with @c snprintf() and
+ * #json_from_str().
+ *
+ * @param tpl    template from #json_template_compile()
+ * @param dst    output buffer, will be NUL terminated
+ * @param dstsz  output buffer size, or 0 to indicate a size request
+ * @param ...    one argument for each slot, in order
+ *
+ * @returns the minimum @a dstsz required (@a dstsz was 0), or
+ *          the number of bytes stored in @a dst including the NUL.
+ * @retval 0 [EINVAL] A string contains invalid UTF-8.
+ * @retval 0 [EINVAL] A double is infinite or NaN.
+ * @retval 0 [ENOMEM] The output buffer is too small.
+ */
+size_t json_template_render(const struct json_template *tpl,
+				__JSON char *dst, size_t dstsz, ...);
+
+/**
+ * @see #json_template_render()
+ *
+ * @param tpl    template from #json_template_compile()
+ * @param dst    output buffer, will be NUL terminated
+ * @param dstsz  output buffer size, or 0 to indicate a size request
+ * @param ap     one argument for each slot, in order
+ */
+size_t json_template_vrender(const struct json_template *tpl,
+				__JSON char *dst, size_t dstsz, va_list ap);
+
 /**
  * Compares a JSON value with a UTF-8 C string.
  *